@@ -0,0 +1,171 @@
+#ifndef BMP_STRIP_WRITER_H
+#define BMP_STRIP_WRITER_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <bitmap_image.hpp>
+
+/**
+ * @brief The BmpStripWriter class writes a 24-bit BMP file strip by
+ * strip, so the whole image never has to be kept in memory.
+ *
+ * Strips are bitmap_image objects of full image width and any height,
+ * written top to bottom. BMP stores rows bottom-up, so every strip is
+ * flipped, padded and written with one write() at its final 64-bit
+ * file offset.
+ *
+ * File and image size header fields are 32-bit in BMP format. For
+ * images larger than 4 GB they are written as 0 (allowed for
+ * uncompressed bitmaps, readers compute the size from dimensions).
+ */
+class BmpStripWriter {
+  public:
+    constexpr static const std::uint64_t HEADER_SIZE = 14 + 40;
+
+    /**
+     * @brief BmpStripWriter creates file and writes BMP headers
+     * @param file_name - output file
+     * @param width - image width in pixels
+     * @param height - image height in pixels
+     */
+    BmpStripWriter(const std::string& file_name, unsigned int width, unsigned int height)
+      : width_(width), height_(height), rows_written_(0) {
+      row_size_ = (3ULL * width_ + 3) & ~3ULL;
+
+      if ((width_ > static_cast<unsigned int>(std::numeric_limits<std::int32_t>::max())) ||
+          (height_ > static_cast<unsigned int>(std::numeric_limits<std::int32_t>::max()))) {
+        std::cerr << "BmpStripWriter::BmpStripWriter(): Error - Image size exceeds BMP limits!" << std::endl;
+        return;
+      }
+
+      stream_.open(file_name.c_str(), std::ios::binary);
+
+      if (!stream_) {
+        std::cerr << "BmpStripWriter::BmpStripWriter(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return;
+      }
+
+      writeHeaders();
+    }
+
+    /**
+     * @brief good
+     * @return true if file is open and no write error happened
+     */
+    bool good() const {
+      return stream_.is_open() && stream_.good();
+    }
+
+    /**
+     * @brief fileSize
+     * @return total size of the BMP file in bytes
+     */
+    std::uint64_t fileSize() const {
+      return HEADER_SIZE + row_size_ * height_;
+    }
+
+    /**
+     * @brief rowsWritten
+     * @return number of image rows written so far
+     */
+    unsigned int rowsWritten() const {
+      return rows_written_;
+    }
+
+    /**
+     * @brief writeStrip writes rows [first_row, first_row + strip.height())
+     * @param strip - image of full width
+     * @param first_row - index of strip first row in the whole image (top-down)
+     * @return false on error
+     */
+    bool writeStrip(const bitmap_image& strip, unsigned int first_row) {
+      if (!good()) return false;
+
+      if ((strip.width() != width_) || (first_row + static_cast<std::uint64_t>(strip.height()) > height_)) {
+        std::cerr << "BmpStripWriter::writeStrip(): Error - Strip does not fit image!" << std::endl;
+        return false;
+      }
+
+      const unsigned int rows = strip.height();
+      const std::size_t line = 3 * static_cast<std::size_t>(width_);
+
+      buffer_.assign(row_size_ * rows, 0x00);
+
+      // Last strip row is the first one in file
+      for (unsigned int i = 0; i < rows; ++i) {
+        std::memcpy(&buffer_[row_size_ * i], strip.row(rows - i - 1), line);
+      }
+
+      const std::uint64_t file_row = height_ - (static_cast<std::uint64_t>(first_row) + rows);
+
+      stream_.seekp(static_cast<std::streamoff>(HEADER_SIZE + file_row * row_size_));
+      stream_.write(reinterpret_cast<const char *>(buffer_.data()),
+                    static_cast<std::streamsize>(buffer_.size()));
+
+      rows_written_ += rows;
+
+      return good();
+    }
+
+    /**
+     * @brief close
+     * @return false if any write failed
+     */
+    bool close() {
+      if (!stream_.is_open()) return false;
+
+      stream_.flush();
+      const bool ok = stream_.good();
+      stream_.close();
+      return ok;
+    }
+
+  private:
+    template <typename T>
+    void writeLE(T value) {
+      for (unsigned int i = 0; i < sizeof(T); ++i) {
+        stream_.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+      }
+    }
+
+    void writeHeaders() {
+      const std::uint64_t image_size = row_size_ * height_;
+      const std::uint64_t max_field = std::numeric_limits<std::uint32_t>::max();
+
+      // bitmap file header
+      writeLE<std::uint16_t>(19778);
+      writeLE<std::uint32_t>(fileSize() > max_field ? 0 : static_cast<std::uint32_t>(fileSize()));
+      writeLE<std::uint16_t>(0);
+      writeLE<std::uint16_t>(0);
+      writeLE<std::uint32_t>(static_cast<std::uint32_t>(HEADER_SIZE));
+
+      // bitmap information header
+      writeLE<std::uint32_t>(40);
+      writeLE<std::uint32_t>(width_);
+      writeLE<std::uint32_t>(height_);
+      writeLE<std::uint16_t>(1);
+      writeLE<std::uint16_t>(24);
+      writeLE<std::uint32_t>(0);
+      writeLE<std::uint32_t>(image_size > max_field ? 0 : static_cast<std::uint32_t>(image_size));
+      writeLE<std::uint32_t>(0);
+      writeLE<std::uint32_t>(0);
+      writeLE<std::uint32_t>(0);
+      writeLE<std::uint32_t>(0);
+    }
+
+    unsigned int width_,
+                 height_,
+                 rows_written_;
+    std::uint64_t row_size_;
+
+    std::ofstream stream_;
+    std::vector<unsigned char> buffer_;
+};
+
+#endif // BMP_STRIP_WRITER_H
@@ -0,0 +1,101 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief The BoundedQueue class is a fixed capacity lock-free multi
+ * producer, multi consumer FIFO (D. Vyukov's bounded MPMC queue).
+ *
+ * Every cell carries a sequence number telling whether it is free for
+ * the producer of a given position or holds the value for the consumer
+ * of it, so push and pop are one CAS on the shared position plus one
+ * release store on the cell. Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class BoundedQueue {
+  public:
+    explicit BoundedQueue(std::size_t capacity) : mask_(roundUp(capacity) - 1),
+      cells_(new Cell[mask_ + 1]), enqueue_(0), dequeue_(0) {
+      for (std::size_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * @brief push
+     * @return false if queue is full
+     */
+    bool push(const T& value) {
+      std::size_t position = enqueue_.load(std::memory_order_relaxed);
+
+      for (;;) {
+        Cell& cell = cells_[position & mask_];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+        if (difference == 0) {
+          if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            cell.value = value;
+            cell.sequence.store(position + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (difference < 0) {
+          return false;
+        } else {
+          position = enqueue_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /**
+     * @brief pop
+     * @return false if queue is empty (or its head is still being written)
+     */
+    bool pop(T& value) {
+      std::size_t position = dequeue_.load(std::memory_order_relaxed);
+
+      for (;;) {
+        Cell& cell = cells_[position & mask_];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+        if (difference == 0) {
+          if (dequeue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            value = cell.value;
+            cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (difference < 0) {
+          return false;
+        } else {
+          position = dequeue_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+  private:
+    struct Cell {
+      std::atomic<std::size_t> sequence;
+      T value;
+    };
+
+    static std::size_t roundUp(std::size_t capacity) {
+      std::size_t size = 2;
+
+      while (size < capacity) size <<= 1;
+
+      return size;
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    // Producers and consumers contend on different cache lines
+    alignas(64) std::atomic<std::size_t> enqueue_;
+    alignas(64) std::atomic<std::size_t> dequeue_;
+};
+
+#endif // BOUNDED_QUEUE_H
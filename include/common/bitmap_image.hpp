@@ -154,16 +154,16 @@ class bitmap_image {
     }
 
     inline unsigned char * row(unsigned int row_index) const {
-      return const_cast<unsigned char *>(&data_[(row_index * row_increment_)]);
+      return const_cast<unsigned char *>(&data_[(static_cast<std::size_t>(row_index) * row_increment_)]);
     }
 
     inline void get_pixel(const unsigned int x, const unsigned int y,
                           unsigned char& red,
                           unsigned char& green,
                           unsigned char& blue) const {
-      const unsigned int y_offset = y * row_increment_;
+      const std::size_t y_offset = static_cast<std::size_t>(y) * row_increment_;
       const unsigned int x_offset = x * bytes_per_pixel_;
-      const unsigned int offset = y_offset + x_offset;
+      const std::size_t offset = y_offset + x_offset;
 
       blue = data_[offset + 0];
       green = data_[offset + 1];
@@ -186,9 +186,9 @@ class bitmap_image {
                           const unsigned char red,
                           const unsigned char green,
                           const unsigned char blue) {
-      const unsigned int y_offset = y * row_increment_;
+      const std::size_t y_offset = static_cast<std::size_t>(y) * row_increment_;
       const unsigned int x_offset = x * bytes_per_pixel_;
-      const unsigned int offset = y_offset + x_offset;
+      const std::size_t offset = y_offset + x_offset;
 
       data_[offset + 0] = blue;
       data_[offset + 1] = green;
@@ -418,7 +418,7 @@ class bitmap_image {
       }
     }
 
-    unsigned int get_size() const {
+    std::size_t get_size() const {
       unsigned int padding = (4 - ((3 * width_) % 4)) % 4;
 
       size_t row_size = sizeof(unsigned char) * bytes_per_pixel_ * width_ + padding;
@@ -537,7 +537,7 @@ class bitmap_image {
       }
 
       for (unsigned int i = 0; i < height_; ++i) {
-        const unsigned char *data_ptr = &data_[(row_increment_ * (height_ - i - 1))];
+        const unsigned char *data_ptr = &data_[(static_cast<std::size_t>(row_increment_) * (height_ - i - 1))];
         std::memcpy(write_ptr, data_ptr, sizeof(unsigned char) * bytes_per_pixel_ * width_);
         write_ptr += sizeof(unsigned char) * bytes_per_pixel_ * width_;
         std::memcpy(write_ptr, padding_data, padding);
@@ -585,7 +585,7 @@ class bitmap_image {
       char padding_data[4] = { 0x00, 0x00, 0x00, 0x00 };
 
       for (unsigned int i = 0; i < height_; ++i) {
-        const unsigned char *data_ptr = &data_[(row_increment_ * (height_ - i - 1))];
+        const unsigned char *data_ptr = &data_[(static_cast<std::size_t>(row_increment_) * (height_ - i - 1))];
 
         stream.write(reinterpret_cast<const char *>(data_ptr), sizeof(unsigned char) * bytes_per_pixel_ * width_);
         stream.write(padding_data, padding);
@@ -1465,7 +1465,7 @@ class bitmap_image {
 
     void create_bitmap() {
       row_increment_ = width_ * bytes_per_pixel_;
-      data_.resize(height_ * row_increment_);
+      data_.resize(static_cast<std::size_t>(height_) * row_increment_);
     }
 
     void load_bitmap() {
@@ -1669,6 +1669,26 @@ inline void rgb_to_ycbcr(const unsigned int& length, double *red, double *green,
   }
 }
 
+/*
+ * 8-bit variant of rgb_to_ycbcr working directly on interleaved BGR
+ * pixels (bitmap_image storage order) and producing planar output.
+ * Coefficients are the ones above prescaled by 2^16/255, so the loop
+ * body is pure integer multiply-add without branches or clamping
+ * (results always land in 16..235 / 16..240) and vectorizes well.
+ */
+inline void rgb_to_ycbcr(const unsigned int& length, const unsigned char *bgr,
+                         unsigned char *y, unsigned char *cb, unsigned char *cr) {
+  for (unsigned int i = 0; i < length; ++i) {
+    const int b = bgr[3 * i + 0];
+    const int g = bgr[3 * i + 1];
+    const int r = bgr[3 * i + 2];
+
+    y[i] = static_cast<unsigned char>(((16 << 16) + 32768 + 16829 * r + 33039 * g +  6416 * b) >> 16);
+    cb[i] = static_cast<unsigned char>(((128 << 16) + 32768 -  9714 * r - 19070 * g + 28784 * b) >> 16);
+    cr[i] = static_cast<unsigned char>(((128 << 16) + 32768 + 28784 * r - 24103 * g -  4681 * b) >> 16);
+  }
+}
+
 inline void ycbcr_to_rgb(const unsigned int& length, double *y,   double *cb,    double *cr,
                          double *red, double *green, double *blue) {
   unsigned int i = 0;
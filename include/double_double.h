@@ -0,0 +1,151 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+#include <cmath>
+
+/**
+ * @brief The DoubleDouble struct is an unevaluated sum of two doubles
+ * (hi + lo, |lo| <= ulp(hi) / 2) giving ~106 bits of mantissa.
+ *
+ * Arithmetic is built from error-free transforms (Knuth two-sum,
+ * FMA or Dekker two-product) as in the QD library by Hida, Li and
+ * Bailey. All operations are branch-free sequences of plain double
+ * operations, so compilers can keep them in registers and vectorize.
+ *
+ * Must not be compiled with -ffast-math (reassociation destroys the
+ * error terms).
+ */
+struct DoubleDouble {
+  double hi,
+         lo;
+
+  constexpr DoubleDouble() : hi(0.0), lo(0.0) {
+  }
+
+  constexpr DoubleDouble(double value) : hi(value), lo(0.0) {
+  }
+
+  constexpr DoubleDouble(double high, double low) : hi(high), lo(low) {
+  }
+
+  /**
+   * @brief twoSum s + e == a + b exactly
+   */
+  static DoubleDouble twoSum(double a, double b) {
+    const double s = a + b;
+    const double bb = s - a;
+
+    return { s, (a - (s - bb)) + (b - bb) };
+  }
+
+  /**
+   * @brief quickTwoSum as twoSum, requires |a| >= |b|
+   */
+  static DoubleDouble quickTwoSum(double a, double b) {
+    const double s = a + b;
+
+    return { s, b - (s - a) };
+  }
+
+  /**
+   * @brief twoProd p + e == a * b exactly
+   */
+  static DoubleDouble twoProd(double a, double b) {
+    const double p = a * b;
+#if defined(__FMA__) || defined(FP_FAST_FMA)
+    return { p, std::fma(a, b, -p) };
+#else
+    // Dekker split, exact without hardware FMA (software fma() is slow)
+    constexpr double SPLIT = 134217729.0; // 2^27 + 1
+    const double ta = SPLIT * a;
+    const double a_hi = ta - (ta - a);
+    const double a_lo = a - a_hi;
+    const double tb = SPLIT * b;
+    const double b_hi = tb - (tb - b);
+    const double b_lo = b - b_hi;
+
+    return { p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo };
+#endif
+  }
+
+  static DoubleDouble sqr(const DoubleDouble& a) {
+    DoubleDouble p = twoProd(a.hi, a.hi);
+
+    p.lo += 2.0 * a.hi * a.lo;
+
+    return quickTwoSum(p.hi, p.lo);
+  }
+
+  explicit operator double() const {
+    return hi + lo;
+  }
+};
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+  DoubleDouble s = DoubleDouble::twoSum(a.hi, b.hi);
+  const DoubleDouble t = DoubleDouble::twoSum(a.lo, b.lo);
+
+  s.lo += t.hi;
+  s = DoubleDouble::quickTwoSum(s.hi, s.lo);
+  s.lo += t.lo;
+
+  return DoubleDouble::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, double b) {
+  DoubleDouble s = DoubleDouble::twoSum(a.hi, b);
+
+  s.lo += a.lo;
+
+  return DoubleDouble::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a) {
+  return { -a.hi, -a.lo };
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) {
+  return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+  DoubleDouble p = DoubleDouble::twoProd(a.hi, b.hi);
+
+  p.lo += a.hi * b.lo + a.lo * b.hi;
+
+  return DoubleDouble::quickTwoSum(p.hi, p.lo);
+}
+
+inline DoubleDouble operator*(double a, const DoubleDouble& b) {
+  DoubleDouble p = DoubleDouble::twoProd(a, b.hi);
+
+  p.lo += a * b.lo;
+
+  return DoubleDouble::quickTwoSum(p.hi, p.lo);
+}
+
+inline bool operator>=(const DoubleDouble& a, double b) {
+  return (a.hi > b) || ((a.hi == b) && (a.lo >= 0.0));
+}
+
+inline bool operator>=(const DoubleDouble& a, const DoubleDouble& b) {
+  return (a.hi > b.hi) || ((a.hi == b.hi) && (a.lo >= b.lo));
+}
+
+inline DoubleDouble twice(const DoubleDouble& a) {
+  return { 2.0 * a.hi, 2.0 * a.lo };
+}
+
+inline double twice(double a) {
+  return 2.0 * a;
+}
+
+inline DoubleDouble sqr(const DoubleDouble& a) {
+  return DoubleDouble::sqr(a);
+}
+
+inline double sqr(double a) {
+  return a * a;
+}
+
+#endif // DOUBLE_DOUBLE_H
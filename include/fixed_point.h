@@ -0,0 +1,181 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief The FixedPoint64 struct is a signed Q7.56 fixed-point number
+ * (range +-128, resolution 2^-56) for the escape-time kernel.
+ *
+ * Only integer operations are used, products are truncated towards
+ * minus infinity (arithmetic shift), so results are bit-for-bit the
+ * same on every compiler and CPU, unlike floating point where FMA
+ * contraction or x87 precision change the last bits.
+ *
+ * Integer range is enough for the kernel only if every value stays below
+ * 128: before escape |z| < 2, after one more step |z| <= 4 + |c|, but the
+ * first step squares the pixel coordinate, so zoomed out or very wide
+ * views overflow. JuliaSetGenerator::resolveKernel() checks the view and
+ * falls back to double. Conversions of doubles outside the range saturate.
+ *
+ * Needs 128-bit integers (GCC, Clang).
+ */
+struct FixedPoint64 {
+  constexpr static const int FRACTION_BITS = 56;
+
+  std::int64_t raw;
+
+  constexpr FixedPoint64() : raw(0) {
+  }
+
+  /**
+   * @brief FixedPoint64 exact conversion of value rounded to 2^-56
+   * (frexp/ldexp/llround are exact and correctly rounded everywhere),
+   * saturated to the range (NaN to its minimum)
+   */
+  explicit FixedPoint64(double value) : raw(std::numeric_limits<std::int64_t>::min()) {
+    const double scaled = std::ldexp(value, FRACTION_BITS);
+
+    if (scaled >= 0x1p63) raw = std::numeric_limits<std::int64_t>::max();
+    else if (scaled > -0x1p63) raw = std::llround(scaled);
+  }
+
+  static constexpr FixedPoint64 fromRaw(std::int64_t value) {
+    FixedPoint64 result;
+    result.raw = value;
+    return result;
+  }
+};
+
+inline FixedPoint64 operator+(const FixedPoint64& a, const FixedPoint64& b) {
+  return FixedPoint64::fromRaw(a.raw + b.raw);
+}
+
+inline FixedPoint64 operator-(const FixedPoint64& a, const FixedPoint64& b) {
+  return FixedPoint64::fromRaw(a.raw - b.raw);
+}
+
+inline FixedPoint64 operator*(const FixedPoint64& a, const FixedPoint64& b) {
+  return FixedPoint64::fromRaw(static_cast<std::int64_t>(
+                                 (static_cast<__int128>(a.raw) * b.raw) >> FixedPoint64::FRACTION_BITS));
+}
+
+inline FixedPoint64 operator*(std::int64_t a, const FixedPoint64& b) {
+  return FixedPoint64::fromRaw(a * b.raw);
+}
+
+inline bool operator>=(const FixedPoint64& a, const FixedPoint64& b) {
+  return a.raw >= b.raw;
+}
+
+inline FixedPoint64 sqr(const FixedPoint64& a) {
+  return a * a;
+}
+
+inline FixedPoint64 twice(const FixedPoint64& a) {
+  return FixedPoint64::fromRaw(a.raw * 2);
+}
+
+/**
+ * @brief The FixedPoint128 struct is a signed Q7.120 fixed-point number
+ * (resolution 2^-120, about 7.5e-37) on a 128-bit integer, for zooms
+ * past double-double. Products are computed exactly (256-bit, from four
+ * 64x64 bit partial products) and truncated towards minus infinity.
+ *
+ * Needs 128-bit integers (GCC, Clang).
+ */
+struct FixedPoint128 {
+  constexpr static const int FRACTION_BITS = 120;
+
+  __int128 raw;
+
+  constexpr FixedPoint128() : raw(0) {
+  }
+
+  /**
+   * @brief FixedPoint128 exact conversion of value (every double of
+   * magnitude above 2^-67 is representable), saturated to the range
+   * (NaN to its minimum)
+   */
+  explicit FixedPoint128(double value) : raw(0) {
+    if (!(std::abs(value) < 128.0)) {
+      const __int128 max = ~static_cast<unsigned __int128>(0) >> 1;
+
+      raw = value > 0.0 ? max : -max - 1;
+      return;
+    }
+
+    int exponent;
+    const double mantissa = std::frexp(value, &exponent);
+    // 53 significant bits as integer, value = bits * 2^(exponent - 53)
+    const __int128 bits = static_cast<std::int64_t>(std::ldexp(mantissa, 53));
+    const int shift = exponent - 53 + FRACTION_BITS;
+
+    if (shift >= 0) raw = bits * (static_cast<__int128>(1) << shift);
+    else if (shift > -64) raw = bits >> -shift;
+  }
+
+  static constexpr FixedPoint128 fromRaw(__int128 value) {
+    FixedPoint128 result;
+    result.raw = value;
+    return result;
+  }
+};
+
+inline FixedPoint128 operator+(const FixedPoint128& a, const FixedPoint128& b) {
+  return FixedPoint128::fromRaw(a.raw + b.raw);
+}
+
+inline FixedPoint128 operator-(const FixedPoint128& a, const FixedPoint128& b) {
+  return FixedPoint128::fromRaw(a.raw - b.raw);
+}
+
+inline FixedPoint128 operator*(const FixedPoint128& a, const FixedPoint128& b) {
+  using u128 = unsigned __int128;
+
+  const bool negative = (a.raw < 0) != (b.raw < 0);
+  const u128 x = a.raw < 0 ? -static_cast<u128>(a.raw) : static_cast<u128>(a.raw);
+  const u128 y = b.raw < 0 ? -static_cast<u128>(b.raw) : static_cast<u128>(b.raw);
+
+  const u128 x_lo = static_cast<std::uint64_t>(x),
+             x_hi = x >> 64,
+             y_lo = static_cast<std::uint64_t>(y),
+             y_hi = y >> 64;
+
+  // 256-bit product = hi:lo
+  const u128 lo_lo = x_lo * y_lo,
+             lo_hi = x_lo * y_hi,
+             hi_lo = x_hi * y_lo,
+             hi_hi = x_hi * y_hi;
+  const u128 middle = (lo_lo >> 64) + static_cast<std::uint64_t>(lo_hi) + static_cast<std::uint64_t>(hi_lo);
+  const u128 lo = (middle << 64) | static_cast<std::uint64_t>(lo_lo);
+  const u128 hi = hi_hi + (lo_hi >> 64) + (hi_lo >> 64) + (middle >> 64);
+
+  // Magnitude >> 120, floor of negative result rounds away from zero
+  const unsigned int shift = FixedPoint128::FRACTION_BITS;
+  u128 magnitude = (hi << (128 - shift)) | (lo >> shift);
+
+  if (negative && (lo & ((static_cast<u128>(1) << shift) - 1))) ++magnitude;
+
+  return FixedPoint128::fromRaw(negative ? -static_cast<__int128>(magnitude) : static_cast<__int128>(magnitude));
+}
+
+inline FixedPoint128 operator*(std::int64_t a, const FixedPoint128& b) {
+  return FixedPoint128::fromRaw(a * b.raw);
+}
+
+inline bool operator>=(const FixedPoint128& a, const FixedPoint128& b) {
+  return a.raw >= b.raw;
+}
+
+inline FixedPoint128 sqr(const FixedPoint128& a) {
+  return a * a;
+}
+
+inline FixedPoint128 twice(const FixedPoint128& a) {
+  return FixedPoint128::fromRaw(a.raw * 2);
+}
+
+#endif // FIXED_POINT_H
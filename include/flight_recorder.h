@@ -0,0 +1,208 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <julia_set_generator.h>
+#include <render_stats.h>
+
+/**
+ * @brief The FlightRecorder class keeps parameters and timings of the
+ * most recent frames and dumps every slow frame to disk, so rare
+ * outliers can be reproduced later.
+ *
+ * A frame is slow when its time (RenderStats::total_ns, or generate_ns
+ * when the frame did not go through the GUI) exceeds the absolute
+ * threshold, or median_factor times the median of recorded frames.
+ *
+ * Dump files are julia_batch option files, replay with:
+ *
+ *     julia_batch --config slow_frame_<time>_<n>.args --format bmp --output frame.bmp
+ *
+ * Stage timings and recent frame history are stored as '#' comments.
+ */
+class FlightRecorder {
+  public:
+    struct Record {
+      JuliaSetGeneratorConfig cfg;
+      std::string kernel,
+                  coloring;
+      unsigned int threads;
+      RenderStats stats;
+      std::int64_t frame_ns;
+    };
+
+    /**
+     * @brief FlightRecorder
+     * @param capacity - number of recent frames kept
+     */
+    explicit FlightRecorder(std::size_t capacity = 64)
+      : capacity_(std::max<std::size_t>(1, capacity)), threshold_ns_(0), median_factor_(0.0), dumps_(0) {
+    }
+
+    /**
+     * @brief setThreshold configures slow frame detection, 0 disables
+     * a criterion
+     * @param threshold_ns - absolute frame time limit
+     * @param median_factor - limit relative to median of recorded frames
+     */
+    void setThreshold(std::int64_t threshold_ns, double median_factor = 0.0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      threshold_ns_ = threshold_ns;
+      median_factor_ = median_factor;
+    }
+
+    /**
+     * @brief setDumpDirectory
+     * @param directory - where slow frame dumps are written, created on first dump
+     */
+    void setDumpDirectory(const std::string& directory) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      directory_ = directory;
+    }
+
+    /**
+     * @brief record adds frame to history, dumps it when slow
+     * @param cfg - generator config of frame
+     * @param kernel - resolved escape-time kernel name the frame was rendered with
+     * @param coloring - colouring name the frame was rendered with
+     * @param threads - render pool thread count
+     * @param stats - frame timings
+     * @return dump file name, empty if frame was not slow or dump failed
+     */
+    std::string record(const JuliaSetGeneratorConfig& cfg, const std::string& kernel, const std::string& coloring,
+                       unsigned int threads, const RenderStats& stats) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      Record record = { cfg, kernel, coloring, threads, stats,
+                        stats.total_ns > 0 ? stats.total_ns : stats.generate_ns };
+
+      // Median of previous frames, the slow one must not raise its own bar
+      const bool slow = ((threshold_ns_ > 0) && (record.frame_ns > threshold_ns_)) ||
+                        ((median_factor_ > 0.0) && !history_.empty() &&
+                         (record.frame_ns > median_factor_ * medianFrameNs()));
+
+      history_.push_back(record);
+
+      if (history_.size() > capacity_) history_.pop_front();
+
+      return slow ? dump(record) : std::string();
+    }
+
+    /**
+     * @brief history
+     * @return copy of recent frames, oldest first
+     */
+    std::vector<Record> history() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      return std::vector<Record>(history_.begin(), history_.end());
+    }
+
+    /**
+     * @brief writeRecord writes frame as julia_batch options, timings as comments
+     */
+    static void writeRecord(std::ostream& stream, const Record& record) {
+      const JuliaSetGeneratorConfig& cfg = record.cfg;
+      const RenderStats& stats = record.stats;
+
+      stream << std::setprecision(std::numeric_limits<double>::max_digits10)
+             << "--width " << cfg.width_ << "\n"
+             << "--height " << cfg.height_ << "\n"
+             << "--iterations " << cfg.max_iterations_ << "\n"
+             << "--cr " << cfg.c_realis_ << "\n"
+             << "--ci " << cfg.c_imaginalis_ << "\n"
+             << "--scale " << cfg.zoom_ << "\n"
+             << "--offset-x " << cfg.off_x_ << "\n"
+             << "--offset-y " << cfg.off_y_ << "\n"
+             << "--threads " << record.threads << "\n"
+             << "--kernel " << record.kernel << "\n"
+             << "--coloring " << record.coloring << "\n"
+             << "# frame_ns " << record.frame_ns << "\n"
+             << "# queue_wait_ns " << stats.queue_wait_ns << "\n"
+             << "# generate_ns " << stats.generate_ns << "\n"
+             << "# kernel_ns " << stats.kernel_ns << "\n"
+             << "# colorize_ns " << stats.colorize_ns << "\n"
+             << "# get_image_ns " << stats.get_image_ns << "\n"
+             << "# from_data_ns " << stats.from_data_ns << "\n"
+             << "# from_image_ns " << stats.from_image_ns << "\n"
+             << "# scene_update_ns " << stats.scene_update_ns << "\n"
+             << "# fit_in_view_ns " << stats.fit_in_view_ns << "\n"
+             << "# total_ns " << stats.total_ns << "\n"
+             << "# iterations " << stats.iterations << "\n"
+             << "# pixels " << stats.pixels << "\n";
+    }
+
+  private:
+    std::int64_t medianFrameNs() const {
+      std::vector<std::int64_t> times;
+
+      for (const Record& record : history_) times.push_back(record.frame_ns);
+
+      std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+
+      return times[times.size() / 2];
+    }
+
+    std::string dump(const Record& record) {
+      const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+      char time_text[32];
+
+      std::strftime(time_text, sizeof(time_text), "%Y%m%d_%H%M%S", std::localtime(&now));
+
+      const std::filesystem::path directory = directory_.empty() ? std::filesystem::path(".")
+                                                                 : std::filesystem::path(directory_);
+      const std::string file_name = (directory / ("slow_frame_" + std::string(time_text) + "_" +
+                                                  std::to_string(++dumps_) + ".args")).string();
+
+      std::error_code error;
+      std::filesystem::create_directories(directory, error);
+
+      std::ofstream stream(file_name.c_str());
+
+      if (!stream) {
+        std::cerr << "FlightRecorder::dump(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return std::string();
+      }
+
+      stream << "# Slow frame, replay: julia_batch --config " << file_name << " --format bmp --output frame.bmp\n";
+      writeRecord(stream, record);
+
+      stream << "# history, oldest first: frame_ns generate_ns kernel_ns width height iterations scale\n";
+
+      for (const Record& previous : history_) {
+        stream << "#   " << previous.frame_ns << " " << previous.stats.generate_ns << " "
+               << previous.stats.kernel_ns << " " << previous.cfg.width_ << " " << previous.cfg.height_
+               << " " << previous.cfg.max_iterations_ << " " << previous.cfg.zoom_ << "\n";
+      }
+
+      if (!stream.good()) return std::string();
+
+      std::cerr << "FlightRecorder: slow frame (" << record.frame_ns / 1000000 << " ms) dumped to "
+                << file_name << std::endl;
+
+      return file_name;
+    }
+
+    mutable std::mutex mutex_;
+    std::deque<Record> history_;
+    std::size_t capacity_;
+    std::int64_t threshold_ns_;
+    double median_factor_;
+    std::string directory_;
+    unsigned int dumps_;
+};
+
+#endif // FLIGHT_RECORDER_H
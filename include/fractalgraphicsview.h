@@ -3,17 +3,45 @@
 #include <QObject>
 #include <QWidget>
 #include <QGraphicsView>
+#include <QImage>
+#include <memory>
+#include <render_profile.h>
 
 class FractalGraphicsView : public QGraphicsView {
   Q_OBJECT
   public:
+    /**
+     * @brief The HeatmapMode enum selects render cost overlay,
+     * values match heatmap combo box entries
+     */
+    enum HeatmapMode {
+      HeatmapOff = 0,
+      HeatmapIterations, //!< per pixel, log scale iteration count
+      HeatmapTileTime,   //!< per tile compute time, linear to slowest tile
+      HeatmapTileThread  //!< pool thread that computed the tile
+    };
+
     FractalGraphicsView(QWidget *parent);
 
+    /**
+     * @brief setHeatmap builds hot_colormap overlay drawn semi-transparent
+     * over the scene rect
+     * @param profile - cost data of displayed frame, nullptr clears overlay
+     * @param mode - overlay kind
+     */
+    void setHeatmap(std::shared_ptr<const RenderProfile> profile, HeatmapMode mode);
+
     void setZoomAnimationTime(int duration_ms);
 
     void wheelEvent(QWheelEvent *event);
 
+  protected:
+    void drawForeground(QPainter *painter, const QRectF& rect) override;
+
   private:
+    QImage heatmap_;
+    unsigned int heatmapScale_; //!< scene pixels per heatmap pixel
+
     int numScheduledScalings_; //!< How much to scale during one animation step
     int zoomAnimationTime_;
 
@@ -2,7 +2,12 @@
 #define FRACTALWORKER_H
 
 #include <QThread>
+#include <QElapsedTimer>
 #include <julia_set_generator.h>
+#include <iteration_cache.h>
+#include <render_stats.h>
+#include <render_profile.h>
+#include <render_trace.h>
 
 class FractalWorker : public QThread {
   Q_OBJECT
@@ -12,13 +17,86 @@ class FractalWorker : public QThread {
     void run() override;
 
     qint64 lastGenerateDurationMs() const {
+      return lastDuration_ / 1000000;
+    }
+
+    qint64 lastGenerateDurationNs() const {
       return lastDuration_;
     }
 
+    /**
+     * @brief lastStats
+     * @return queue wait, generate, kernel and colorize timings and counters of last run
+     */
+    const RenderStats& lastStats() const {
+      return stats_;
+    }
+
+    /**
+     * @brief setProfile enables detailed cost profiling of next run
+     * @param profile - filled by run(), nullptr disables profiling
+     */
+    void setProfile(std::shared_ptr<RenderProfile> profile) {
+      profile_ = std::move(profile);
+    }
+
+    std::shared_ptr<RenderProfile> profile() const {
+      return profile_;
+    }
+
+    /**
+     * @brief setConfig overrides config rendered by run(), generator
+     * config at construction by default
+     * @param config - e.g. reduced resolution frame of the same view
+     */
+    void setConfig(const JuliaSetGeneratorConfig& config) {
+      config_ = config;
+    }
+
+    /**
+     * @brief setCache makes run() take escape iterations from the
+     * iteration cache (and store them there), unless profiling
+     * @param cache - nullptr renders directly (default)
+     */
+    void setCache(std::shared_ptr<IterationCache> cache) {
+      cache_ = std::move(cache);
+    }
+
+    /**
+     * @brief lastConfig
+     * @return config of last run, GUI may change generator meanwhile
+     */
+    const JuliaSetGeneratorConfig& lastConfig() const {
+      return config_;
+    }
+
+    /**
+     * @brief lastKernelName
+     * @return resolved escape-time kernel of last run
+     */
+    const std::string& lastKernelName() const {
+      return kernelName_;
+    }
+
+    /**
+     * @brief lastColoringName
+     * @return colouring of last run
+     */
+    const std::string& lastColoringName() const {
+      return coloringName_;
+    }
+
   private:
     JuliaSetGenerator *generator_;
 
-    qint64 lastDuration_;
+    qint64 lastDuration_; //!< ns
+    QElapsedTimer queueTimer_; //!< started on construction, i.e. on render request
+    RenderStats stats_;
+    std::shared_ptr<RenderProfile> profile_;
+    std::shared_ptr<IterationCache> cache_;
+    JuliaSetGeneratorConfig config_;
+    std::string kernelName_,
+                coloringName_;
   signals:
     void fractalReady(std::shared_ptr<bitmap_image> fractal);
 
@@ -0,0 +1,152 @@
+#ifndef FRAME_BUDGET_H
+#define FRAME_BUDGET_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <julia_set_generator.h>
+#include <render_stats.h>
+
+/**
+ * @brief The FrameBudgetController class picks render resolution (and
+ * optionally max iterations) of interactive frames, so they fit into
+ * a frame-time budget.
+ *
+ * Cost model is time per pixel per full max iterations, measured on
+ * recent frames (exponential moving average), assuming frame time
+ * scales with pixel count and max iterations. Resolution goes down
+ * first (down to MIN_RESOLUTION_SCALE of each side), iterations only
+ * when even that is too slow. Full quality frames (refinement when
+ * input goes idle) are rendered with fullConfig().
+ */
+class FrameBudgetController {
+  public:
+    constexpr static const double MIN_RESOLUTION_SCALE = 0.25,
+                                  MIN_ITERATION_SCALE = 0.125,
+                                  SMOOTHING = 0.5; //!< weight of newest frame in cost estimate
+
+    FrameBudgetController() : budget_ns_(0), scale_iterations_(false), ns_per_pixel_(0.0),
+      resolution_scale_(1.0), iteration_scale_(1.0) {
+    }
+
+    /**
+     * @brief setBudget
+     * @param budget_ns - target frame time, 0 disables the controller
+     */
+    FrameBudgetController& setBudget(std::int64_t budget_ns) {
+      budget_ns_ = budget_ns;
+      return *this;
+    }
+
+    std::int64_t budget() const {
+      return budget_ns_;
+    }
+
+    bool enabled() const {
+      return budget_ns_ > 0;
+    }
+
+    /**
+     * @brief setScaleIterations
+     * @param scale - allow lowering max iterations below full quality
+     */
+    FrameBudgetController& setScaleIterations(bool scale) {
+      scale_iterations_ = scale;
+      return *this;
+    }
+
+    /**
+     * @brief frameConfig
+     * @param full - full quality config
+     * @return config of next interactive frame, same view at lower
+     * resolution and/or iterations, full when controller is disabled or
+     * there is no measurement yet
+     */
+    JuliaSetGeneratorConfig frameConfig(const JuliaSetGeneratorConfig& full) {
+      resolution_scale_ = 1.0;
+      iteration_scale_ = 1.0;
+
+      if (!enabled() || (ns_per_pixel_ <= 0.0)) return full;
+
+      const double full_pixels = static_cast<double>(full.width_) * full.height_;
+      const double area_scale = budget_ns_ / (ns_per_pixel_ * full_pixels);
+
+      resolution_scale_ = std::max(MIN_RESOLUTION_SCALE, std::min(1.0, std::sqrt(area_scale)));
+
+      if (scale_iterations_) {
+        iteration_scale_ = std::max(MIN_ITERATION_SCALE, std::min(1.0, area_scale / (resolution_scale_ * resolution_scale_)));
+      }
+
+      return scaledConfig(full, resolution_scale_, iteration_scale_);
+    }
+
+    /**
+     * @brief fullConfig
+     * @return full quality config, scales of the frame are reset to 1
+     */
+    JuliaSetGeneratorConfig fullConfig(const JuliaSetGeneratorConfig& full) {
+      resolution_scale_ = 1.0;
+      iteration_scale_ = 1.0;
+
+      return full;
+    }
+
+    /**
+     * @brief record updates cost estimate with a finished frame
+     * @param cfg - config the frame was rendered with
+     * @param full - full quality config of the frame
+     * @param stats - frame timings, total_ns (or generate_ns) is used
+     */
+    void record(const JuliaSetGeneratorConfig& cfg, const JuliaSetGeneratorConfig& full, const RenderStats& stats) {
+      const std::int64_t frame_ns = stats.total_ns > 0 ? stats.total_ns : stats.generate_ns;
+      const double pixels = static_cast<double>(cfg.width_) * cfg.height_;
+
+      if ((frame_ns <= 0) || (pixels <= 0.0) || (full.max_iterations_ == 0)) return;
+
+      const double iteration_scale = static_cast<double>(cfg.max_iterations_) / full.max_iterations_;
+      const double sample = frame_ns / (pixels * iteration_scale);
+
+      ns_per_pixel_ = (ns_per_pixel_ > 0.0) ? SMOOTHING * sample + (1.0 - SMOOTHING) * ns_per_pixel_ : sample;
+    }
+
+    /**
+     * @brief reduced
+     * @return true if last frameConfig() was below full quality
+     */
+    bool reduced() const {
+      return (resolution_scale_ < 1.0) || (iteration_scale_ < 1.0);
+    }
+
+    double resolutionScale() const {
+      return resolution_scale_;
+    }
+
+    double iterationScale() const {
+      return iteration_scale_;
+    }
+
+    /**
+     * @brief scaledConfig same view as cfg, each side scaled by
+     * resolution_scale and max iterations by iteration_scale
+     */
+    static JuliaSetGeneratorConfig scaledConfig(const JuliaSetGeneratorConfig& cfg, double resolution_scale,
+                                                double iteration_scale) {
+      JuliaSetGeneratorConfig scaled = cfg;
+
+      scaled.width_ = std::max(1U, static_cast<unsigned int>(std::lround(cfg.width_ * resolution_scale)));
+      scaled.height_ = std::max(1U, static_cast<unsigned int>(std::lround(cfg.height_ * resolution_scale)));
+      scaled.w2h_ = static_cast<double>(scaled.width_) / scaled.height_;
+      scaled.max_iterations_ = std::max(1U, static_cast<unsigned int>(std::lround(cfg.max_iterations_ * iteration_scale)));
+
+      return scaled;
+    }
+
+  private:
+    std::int64_t budget_ns_;
+    bool scale_iterations_;
+    double ns_per_pixel_; //!< frame time per pixel at full max iterations
+    double resolution_scale_,
+           iteration_scale_;
+};
+
+#endif // FRAME_BUDGET_H
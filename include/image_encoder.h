@@ -0,0 +1,495 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <bitmap_image.hpp>
+#include <render_pool.h>
+
+#ifdef HAVE_ZLIB
+  #include <zlib.h>
+#endif
+
+/**
+ * @brief The ImageEncoder class encodes bitmap_image into compressed
+ * image files, splitting the work into horizontal strips encoded in
+ * parallel on a RenderPool.
+ *
+ * Formats:
+ * - BMP - uncompressed, bitmap_image::save_image()
+ * - QOI - "Quite OK Image" format, very fast lossless. Every strip is
+ *   encoded independently: it starts with the last pixel of previous
+ *   strip and an empty colour index and never references index slots
+ *   it has not written itself, so the concatenated stream is a valid
+ *   single QOI stream.
+ * - PNG - rows are filtered (per row adaptive filter) and deflated
+ *   strip by strip like pigz does: raw deflate streams primed with the
+ *   previous strip tail as dictionary, sync-flushed and concatenated,
+ *   adler32 combined. Needs zlib (HAVE_ZLIB).
+ */
+class ImageEncoder {
+  public:
+    enum class Format {
+      BMP,
+      QOI,
+      PNG
+    };
+
+    /**
+     * @brief ImageEncoder
+     * @param pool - pool used for strip encoding, nullptr means global pool
+     * @param png_level - zlib compression level used for PNG (1 fastest - 9 best)
+     */
+    explicit ImageEncoder(std::shared_ptr<RenderPool> pool = nullptr, int png_level = 1)
+      : pool_(pool ? std::move(pool) : RenderPool::global()), png_level_(png_level) {
+    }
+
+    /**
+     * @brief formatFromName maps "bmp", "qoi", "png" to Format
+     * @param name - format name
+     * @param format - result
+     * @return false for unknown (or unavailable) format
+     */
+    static bool formatFromName(const std::string& name, Format& format) {
+      if (name == "bmp") format = Format::BMP;
+      else if (name == "qoi") format = Format::QOI;
+#ifdef HAVE_ZLIB
+      else if (name == "png") format = Format::PNG;
+#endif
+      else return false;
+
+      return true;
+    }
+
+    /**
+     * @brief extension
+     * @param format
+     * @return file extension without dot
+     */
+    static const char * extension(Format format) {
+      switch (format) {
+        case Format::QOI:
+          return "qoi";
+
+        case Format::PNG:
+          return "png";
+
+        default:
+          return "bmp";
+      }
+    }
+
+    /**
+     * @brief encode
+     * @param image - source image
+     * @param format - output format
+     * @return encoded file contents, empty on error
+     */
+    std::vector<unsigned char> encode(const bitmap_image& image, Format format) const {
+      switch (format) {
+        case Format::QOI:
+          return encodeQoi(image);
+
+        case Format::PNG:
+          return encodePng(image);
+
+        default: {
+          auto bmp = image.get_image();
+          // get_size() counts in-memory header structs, file headers are 2 bytes shorter
+          return std::vector<unsigned char>(bmp.get(), bmp.get() + image.get_size() - 2);
+        }
+      }
+    }
+
+    /**
+     * @brief save encodes image and writes it to file
+     * @param image - source image
+     * @param file_name - output file
+     * @param format - output format
+     * @return false on error
+     */
+    bool save(const bitmap_image& image, const std::string& file_name, Format format) const {
+      if (format == Format::BMP) {
+        image.save_image(file_name);
+        return true;
+      }
+
+      const std::vector<unsigned char> data = encode(image, format);
+
+      if (data.empty()) return false;
+
+      std::ofstream stream(file_name.c_str(), std::ios::binary);
+
+      if (!stream) {
+        std::cerr << "ImageEncoder::save(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return false;
+      }
+
+      stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+      return stream.good();
+    }
+
+    /**
+     * @brief encodeQoi
+     * @param image - source image
+     * @return QOI file contents
+     */
+    std::vector<unsigned char> encodeQoi(const bitmap_image& image) const {
+      const unsigned int width = image.width();
+      const unsigned int height = image.height();
+      const unsigned int strip_rows = stripRows(height);
+      const std::size_t strips = (height + strip_rows - 1) / strip_rows;
+
+      std::vector<std::vector<unsigned char> > chunks(strips);
+
+      pool_->parallelFor(strips, [&](std::size_t s) {
+        const unsigned int first_row = static_cast<unsigned int>(s) * strip_rows;
+        const unsigned int rows = std::min(strip_rows, height - first_row);
+
+        std::vector<unsigned char>& out = chunks[s];
+        out.reserve(static_cast<std::size_t>(width) * rows);
+
+        // Decoder starts with {0, 0, 0, 255}, later strips continue from previous strip last pixel
+        std::uint32_t prev = 0x000000FF;
+
+        if (first_row > 0) prev = qoiPixel(image.row(first_row - 1) + 3 * (width - 1));
+
+        std::uint32_t index[64];
+        bool index_known[64] = { false };
+        unsigned int run = 0;
+
+        for (unsigned int y = first_row; y < first_row + rows; ++y) {
+          const unsigned char *src = image.row(y);
+
+          for (unsigned int x = 0; x < width; ++x, src += 3) {
+            const std::uint32_t px = qoiPixel(src);
+
+            if (px == prev) {
+              if (++run == 62) {
+                out.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+                run = 0;
+              }
+
+              continue;
+            }
+
+            if (run > 0) {
+              out.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+              run = 0;
+            }
+
+            const unsigned char r = static_cast<unsigned char>(px >> 24);
+            const unsigned char g = static_cast<unsigned char>(px >> 16);
+            const unsigned char b = static_cast<unsigned char>(px >> 8);
+            const unsigned int slot = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+
+            if (index_known[slot] && (index[slot] == px)) {
+              out.push_back(static_cast<unsigned char>(slot));
+            } else {
+              index[slot] = px;
+              index_known[slot] = true;
+
+              const signed char vr = static_cast<signed char>(r - static_cast<unsigned char>(prev >> 24));
+              const signed char vg = static_cast<signed char>(g - static_cast<unsigned char>(prev >> 16));
+              const signed char vb = static_cast<signed char>(b - static_cast<unsigned char>(prev >> 8));
+              const signed char vg_r = static_cast<signed char>(vr - vg);
+              const signed char vg_b = static_cast<signed char>(vb - vg);
+
+              if ((vr > -3) && (vr < 2) && (vg > -3) && (vg < 2) && (vb > -3) && (vb < 2)) {
+                out.push_back(static_cast<unsigned char>(0x40 | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2)));
+              } else if ((vg_r > -9) && (vg_r < 8) && (vg > -33) && (vg < 32) && (vg_b > -9) && (vg_b < 8)) {
+                out.push_back(static_cast<unsigned char>(0x80 | (vg + 32)));
+                out.push_back(static_cast<unsigned char>(((vg_r + 8) << 4) | (vg_b + 8)));
+              } else {
+                out.push_back(0xFE);
+                out.push_back(r);
+                out.push_back(g);
+                out.push_back(b);
+              }
+            }
+
+            prev = px;
+          }
+        }
+
+        // Runs never cross strip boundary
+        if (run > 0) out.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+      });
+
+      std::vector<unsigned char> result;
+      std::size_t total = 14 + 8;
+
+      for (const auto& chunk : chunks) total += chunk.size();
+
+      result.reserve(total);
+
+      const unsigned char magic[] = { 'q', 'o', 'i', 'f' };
+      result.insert(result.end(), magic, magic + 4);
+      appendBE32(result, width);
+      appendBE32(result, height);
+      result.push_back(3); // channels
+      result.push_back(0); // sRGB
+
+      for (const auto& chunk : chunks) result.insert(result.end(), chunk.begin(), chunk.end());
+
+      const unsigned char end_marker[] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+      result.insert(result.end(), end_marker, end_marker + 8);
+
+      return result;
+    }
+
+    /**
+     * @brief encodePng
+     * @param image - source image
+     * @return PNG file contents, empty if built without zlib
+     */
+    std::vector<unsigned char> encodePng(const bitmap_image& image) const {
+#ifdef HAVE_ZLIB
+      const unsigned int width = image.width();
+      const unsigned int height = image.height();
+      const unsigned int strip_rows = stripRows(height);
+      const std::size_t strips = (height + strip_rows - 1) / strip_rows;
+      const std::size_t line = 3 * static_cast<std::size_t>(width);
+
+      // Pass 1: filter rows, strips in parallel
+      std::vector<std::vector<unsigned char> > filtered(strips);
+
+      pool_->parallelFor(strips, [&](std::size_t s) {
+        const unsigned int first_row = static_cast<unsigned int>(s) * strip_rows;
+        const unsigned int rows = std::min(strip_rows, height - first_row);
+
+        std::vector<unsigned char> prev_rgb(line, 0),
+                                   rgb(line),
+                                   candidate(line);
+
+        if (first_row > 0) bgrToRgb(image.row(first_row - 1), prev_rgb.data(), width);
+
+        std::vector<unsigned char>& out = filtered[s];
+        out.resize((line + 1) * rows);
+
+        for (unsigned int i = 0; i < rows; ++i) {
+          bgrToRgb(image.row(first_row + i), rgb.data(), width);
+          filterRow(rgb.data(), prev_rgb.data(), line, candidate.data(), &out[(line + 1) * i]);
+          rgb.swap(prev_rgb);
+        }
+      });
+
+      // Pass 2: deflate strips in parallel, each primed with previous strip tail
+      std::vector<std::vector<unsigned char> > deflated(strips);
+      std::vector<uLong> adlers(strips);
+      std::atomic<bool> ok(true);
+
+      pool_->parallelFor(strips, [&](std::size_t s) {
+        const std::vector<unsigned char>& in = filtered[s];
+
+        adlers[s] = adler32(adler32(0L, Z_NULL, 0), in.data(), static_cast<uInt>(in.size()));
+
+        z_stream stream {};
+
+        if (deflateInit2(&stream, png_level_, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+          ok = false;
+          return;
+        }
+
+        if (s > 0) {
+          const std::vector<unsigned char>& prev = filtered[s - 1];
+          const std::size_t dict = std::min<std::size_t>(prev.size(), 32768);
+          deflateSetDictionary(&stream, prev.data() + prev.size() - dict, static_cast<uInt>(dict));
+        }
+
+        std::vector<unsigned char>& out = deflated[s];
+        out.resize(deflateBound(&stream, static_cast<uLong>(in.size())) + 16);
+
+        stream.next_in = const_cast<Bytef *>(in.data());
+        stream.avail_in = static_cast<uInt>(in.size());
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+
+        // Only last strip terminates deflate stream
+        const int flush = (s + 1 == strips) ? Z_FINISH : Z_SYNC_FLUSH;
+        int ret;
+
+        while (((ret = deflate(&stream, flush)) == Z_OK) && (stream.avail_out == 0)) {
+          const std::size_t used = out.size();
+          out.resize(2 * used);
+          stream.next_out = out.data() + used;
+          stream.avail_out = static_cast<uInt>(out.size() - used);
+        }
+
+        if ((ret != Z_OK) && (ret != Z_STREAM_END)) ok = false;
+
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+      });
+
+      if (!ok) {
+        std::cerr << "ImageEncoder::encodePng(): Error - Deflate failed!" << std::endl;
+        return {};
+      }
+
+      uLong adler = adler32(0L, Z_NULL, 0);
+
+      for (std::size_t s = 0; s < strips; ++s) {
+        adler = adler32_combine(adler, adlers[s], static_cast<z_off_t>(filtered[s].size()));
+      }
+
+      std::vector<unsigned char> result;
+
+      const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+      result.insert(result.end(), signature, signature + 8);
+
+      std::vector<unsigned char> ihdr;
+      appendBE32(ihdr, width);
+      appendBE32(ihdr, height);
+      ihdr.push_back(8); // bit depth
+      ihdr.push_back(2); // truecolor
+      ihdr.push_back(0); // deflate
+      ihdr.push_back(0); // adaptive filtering
+      ihdr.push_back(0); // no interlace
+      appendPngChunk(result, "IHDR", ihdr.data(), ihdr.size());
+
+      // zlib stream split into IDAT chunks: header, strips, adler32
+      const unsigned char zlib_header[] = { 0x78, 0x01 };
+      appendPngChunk(result, "IDAT", zlib_header, 2);
+
+      for (const auto& chunk : deflated) appendPngChunk(result, "IDAT", chunk.data(), chunk.size());
+
+      std::vector<unsigned char> trailer;
+      appendBE32(trailer, static_cast<std::uint32_t>(adler));
+      appendPngChunk(result, "IDAT", trailer.data(), trailer.size());
+
+      appendPngChunk(result, "IEND", nullptr, 0);
+
+      return result;
+#else
+      (void)image;
+      std::cerr << "ImageEncoder::encodePng(): Error - Built without zlib!" << std::endl;
+      return {};
+#endif
+    }
+
+  private:
+    /**
+     * @brief stripRows - at least 16 rows per strip, about 4 strips per thread
+     */
+    unsigned int stripRows(unsigned int height) const {
+      const unsigned int strips = 4 * pool_->threadCount();
+
+      return std::max(16U, (height + strips - 1) / strips);
+    }
+
+    static std::uint32_t qoiPixel(const unsigned char *bgr) {
+      return (static_cast<std::uint32_t>(bgr[2]) << 24) |
+             (static_cast<std::uint32_t>(bgr[1]) << 16) |
+             (static_cast<std::uint32_t>(bgr[0]) << 8) |
+             0xFF;
+    }
+
+    static void appendBE32(std::vector<unsigned char>& out, std::uint32_t value) {
+      out.push_back(static_cast<unsigned char>(value >> 24));
+      out.push_back(static_cast<unsigned char>(value >> 16));
+      out.push_back(static_cast<unsigned char>(value >> 8));
+      out.push_back(static_cast<unsigned char>(value));
+    }
+
+    static void bgrToRgb(const unsigned char *bgr, unsigned char *rgb, unsigned int width) {
+      for (unsigned int x = 0; x < width; ++x, bgr += 3, rgb += 3) {
+        rgb[0] = bgr[2];
+        rgb[1] = bgr[1];
+        rgb[2] = bgr[0];
+      }
+    }
+
+#ifdef HAVE_ZLIB
+    static unsigned char paeth(int a, int b, int c) {
+      const int p = a + b - c;
+      const int pa = std::abs(p - a);
+      const int pb = std::abs(p - b);
+      const int pc = std::abs(p - c);
+
+      if ((pa <= pb) && (pa <= pc)) return static_cast<unsigned char>(a);
+
+      if (pb <= pc) return static_cast<unsigned char>(b);
+
+      return static_cast<unsigned char>(c);
+    }
+
+    /**
+     * @brief filterRow picks PNG filter with minimal sum of absolute
+     * differences (libpng heuristic) and writes filter byte + row to out
+     */
+    static void filterRow(const unsigned char *row, const unsigned char *prev, std::size_t line,
+                          unsigned char *candidate, unsigned char *out) {
+      std::size_t best_sum = std::numeric_limits<std::size_t>::max();
+
+      for (unsigned char type = 0; type < 5; ++type) {
+        std::size_t sum = 0;
+
+        for (std::size_t i = 0; i < line; ++i) {
+          const int a = (i >= 3) ? row[i - 3] : 0;
+          const int b = prev[i];
+          const int c = (i >= 3) ? prev[i - 3] : 0;
+          unsigned char predictor;
+
+          switch (type) {
+            case 1:
+              predictor = static_cast<unsigned char>(a);
+              break;
+
+            case 2:
+              predictor = static_cast<unsigned char>(b);
+              break;
+
+            case 3:
+              predictor = static_cast<unsigned char>((a + b) / 2);
+              break;
+
+            case 4:
+              predictor = paeth(a, b, c);
+              break;
+
+            default:
+              predictor = 0;
+          }
+
+          candidate[i] = static_cast<unsigned char>(row[i] - predictor);
+          sum += static_cast<std::size_t>(std::abs(static_cast<signed char>(candidate[i])));
+        }
+
+        if (sum < best_sum) {
+          best_sum = sum;
+          out[0] = type;
+          std::copy(candidate, candidate + line, out + 1);
+        }
+      }
+    }
+
+    static void appendPngChunk(std::vector<unsigned char>& out, const char *type,
+                               const unsigned char *data, std::size_t size) {
+      appendBE32(out, static_cast<std::uint32_t>(size));
+
+      const std::size_t type_pos = out.size();
+      out.insert(out.end(), type, type + 4);
+
+      if (size > 0) out.insert(out.end(), data, data + size);
+
+      const uLong crc = crc32(crc32(0L, Z_NULL, 0), &out[type_pos], static_cast<uInt>(size + 4));
+      appendBE32(out, static_cast<std::uint32_t>(crc));
+    }
+#endif
+
+    std::shared_ptr<RenderPool> pool_;
+    int png_level_;
+};
+
+#endif // IMAGE_ENCODER_H
@@ -0,0 +1,470 @@
+#ifndef ITERATION_CACHE_H
+#define ITERATION_CACHE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <bitmap_image.hpp>
+#include <iteration_codec.h>
+#include <julia_set_generator.h>
+#include <render_stats.h>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+/**
+ * @brief The IterationCache class is a persistent, content-addressed
+ * cache of iteration buffers of whole frames in a directory, shared by
+ * the GUI and julia_batch (also between processes).
+ *
+ * Entries are named by a 64-bit FNV-1a hash of every result-relevant
+ * config field (exact bits of doubles) and the resolved kernel, the full
+ * key is stored in the entry and compared on load. Iterations are
+ * stored as TiledIterations frame (decoded in parallel). Entries are written to a temporary
+ * file and renamed, so readers never see partial ones, and read through
+ * a read-only memory mapping.
+ *
+ * Size is bounded by capacity: after every store the least recently used
+ * entries (file modification time, refreshed on every hit) are deleted,
+ * as are temporary files older than STALE_TEMPORARY_AGE left behind by
+ * crashed or killed writers.
+ *
+ * Frames computed on a miss are encoded, stored and evicted by a writer
+ * thread, off the render path. At most MAX_PENDING_STORES frames wait,
+ * a miss blocks while the queue is full. Pending stores are finished by
+ * flush() and the destructor.
+ */
+class IterationCache {
+  public:
+    constexpr static const std::uint32_t VERSION = 2;
+    constexpr static const std::uint64_t MAX_PIXELS = 1ULL << 28; //!< larger frames bypass the cache
+    constexpr static const std::size_t MAX_PENDING_STORES = 2;
+    constexpr static const char *EXTENSION = ".jit";
+    constexpr static const std::chrono::seconds STALE_TEMPORARY_AGE = std::chrono::hours(1);
+
+    /**
+     * @brief IterationCache
+     * @param directory - cache directory, created on first store
+     * @param capacity - max total size of entries in bytes
+     */
+    IterationCache(const std::string& directory, std::uint64_t capacity)
+      : directory_(directory), capacity_(capacity), closed_(false), storing_(false) {
+    }
+
+    IterationCache(const IterationCache&) = delete;
+    IterationCache& operator=(const IterationCache&) = delete;
+
+    ~IterationCache() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+      }
+      not_empty_.notify_all();
+
+      if (writer_.joinable()) writer_.join();
+    }
+
+    /**
+     * @brief flush waits until every queued store is written
+     */
+    void flush() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this] {
+        return queue_.empty() && !storing_;
+      });
+    }
+
+    /**
+     * @brief accepts
+     * @return true if frames of cfg are small enough to be cached
+     */
+    static bool accepts(const JuliaSetGeneratorConfig& cfg) {
+      return static_cast<std::uint64_t>(cfg.width_) * cfg.height_ <= MAX_PIXELS;
+    }
+
+    /**
+     * @brief key
+     * @param kernel - resolved kernel name
+     * @return bytes identifying the iterations of cfg
+     */
+    static std::string key(const JuliaSetGeneratorConfig& cfg, const std::string& kernel) {
+      std::string key;
+
+      auto put = [&key](std::uint64_t value, unsigned int size) {
+                   for (unsigned int i = 0; i < size; ++i) key.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+                 };
+      auto putDouble = [&put](double value) {
+                         std::uint64_t bits;
+
+                         std::memcpy(&bits, &value, sizeof(bits));
+                         put(bits, 8);
+                       };
+
+      put(cfg.width_, 4);
+      put(cfg.height_, 4);
+      put(cfg.max_iterations_, 4);
+      putDouble(cfg.c_realis_);
+      putDouble(cfg.c_imaginalis_);
+      putDouble(cfg.zoom_);
+      putDouble(cfg.off_x_);
+      putDouble(cfg.off_y_);
+      key += kernel;
+
+      return key;
+    }
+
+    /**
+     * @brief fileName
+     * @return entry file of key inside cache directory
+     */
+    std::string fileName(const std::string& key) const {
+      std::uint64_t hash = 14695981039346656037ULL;
+
+      for (const char byte : key) {
+        hash ^= static_cast<unsigned char>(byte);
+        hash *= 1099511628211ULL;
+      }
+
+      std::ostringstream name;
+
+      name << std::hex << std::setw(16) << std::setfill('0') << hash << EXTENSION;
+
+      return (std::filesystem::path(directory_) / name.str()).string();
+    }
+
+    /**
+     * @brief load
+     * @param iterations - receives width * height iterations of cfg
+     * @param pool - decodes in parallel if not null
+     * @return false if not cached (or entry unreadable)
+     */
+    bool load(const JuliaSetGeneratorConfig& cfg, const std::string& kernel, std::vector<unsigned int>& iterations,
+              RenderPool *pool = nullptr) const {
+      const std::string entry_key = key(cfg, kernel);
+      const std::string file_name = fileName(entry_key);
+      std::vector<unsigned char> buffer;
+      const unsigned char *data = nullptr;
+      std::size_t size = 0;
+
+#ifndef _WIN32
+      const int fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+
+      if (fd < 0) return false;
+
+      struct stat status;
+      void *map = ((::fstat(fd, &status) == 0) && (status.st_size > 0))
+                  ? ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0)
+                  : MAP_FAILED;
+
+      ::close(fd);
+
+      if (map == MAP_FAILED) return false;
+
+      data = static_cast<const unsigned char *>(map);
+      size = static_cast<std::size_t>(status.st_size);
+#else
+      std::ifstream stream(file_name.c_str(), std::ios::binary);
+
+      if (!stream) return false;
+
+      buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+      data = buffer.data();
+      size = buffer.size();
+#endif
+
+      const bool loaded = decode(data, size, entry_key, cfg.width_, cfg.height_, iterations, pool);
+
+#ifndef _WIN32
+      ::munmap(map, size);
+#endif
+
+      if (loaded) {
+        // Hit makes the entry most recently used
+        std::error_code error;
+        std::filesystem::last_write_time(file_name, std::filesystem::file_time_type::clock::now(), error);
+      }
+
+      return loaded;
+    }
+
+    /**
+     * @brief store writes entry of cfg, then evicts least recently used
+     * entries above capacity
+     * @param iterations - width * height iterations of cfg
+     * @param pool - encodes in parallel if not null
+     * @return false if entry could not be written
+     */
+    bool store(const JuliaSetGeneratorConfig& cfg, const std::string& kernel, const unsigned int *iterations,
+               RenderPool *pool = nullptr) {
+      const std::string entry_key = key(cfg, kernel);
+      const std::string file_name = fileName(entry_key);
+      const std::vector<unsigned char> frame = TiledIterations::encode(iterations, cfg.width_, cfg.height_,
+                                                                       TiledIterations::DEFAULT_TILE_SIZE, pool);
+      std::vector<unsigned char> data(MAGIC, MAGIC + 4);
+
+      putLE(data, VERSION, 4);
+      putLE(data, entry_key.size(), 4);
+      data.insert(data.end(), entry_key.begin(), entry_key.end());
+      data.insert(data.end(), frame.begin(), frame.end());
+
+      std::error_code error;
+      std::filesystem::create_directories(directory_, error);
+
+      // Unique temporary name, other processes may store the same entry
+      const std::string temporary = file_name + ".tmp" + std::to_string(std::random_device()());
+      {
+        std::ofstream stream(temporary.c_str(), std::ios::binary);
+
+        if (!stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()))) {
+          std::cerr << "IterationCache::store(): Error - Could not write file " << temporary << "!" << std::endl;
+          std::filesystem::remove(temporary, error);
+          return false;
+        }
+      }
+
+      std::filesystem::rename(temporary, file_name, error);
+
+      if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+      }
+
+      evict();
+
+      return true;
+    }
+
+    /**
+     * @brief queueStore stores entry of cfg on the writer thread, blocks
+     * while MAX_PENDING_STORES entries wait
+     * @param iterations - width * height iterations of cfg
+     */
+    void queueStore(const JuliaSetGeneratorConfig& cfg, const std::string& kernel, std::vector<unsigned int> iterations) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this] {
+        return queue_.size() < MAX_PENDING_STORES;
+      });
+
+      if (!writer_.joinable()) writer_ = std::thread(&IterationCache::writerLoop, this);
+
+      queue_.push_back({ cfg, kernel, std::move(iterations) });
+      not_empty_.notify_one();
+    }
+
+    /**
+     * @brief iterations loads iterations of cfg (gen's kernel), computes
+     * (resumed from gen's previous frame when resumable) and queues a
+     * store on a miss
+     * @param stats - kernel time (load or compute), iterations and pixels
+     * are added if not null
+     * @return true on cache hit
+     */
+    bool iterations(JuliaSetGenerator& gen, const JuliaSetGeneratorConfig& cfg, std::vector<unsigned int>& iterations,
+                    RenderStats *stats = nullptr) {
+      const std::string kernel = JuliaSetGenerator::kernelName(JuliaSetGenerator::resolveKernel(gen.kernel(), cfg));
+      const auto start = std::chrono::steady_clock::now();
+      const bool hit = load(cfg, kernel, iterations, gen.renderPool().get());
+      std::uint64_t executed = 0;
+
+      if (!hit) {
+        iterations.resize(static_cast<std::size_t>(cfg.width_) * cfg.height_);
+        executed = gen.computeFrameIterations(cfg, iterations.data());
+        queueStore(cfg, kernel, iterations);
+      }
+
+      if (stats) {
+        stats->kernel_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+        stats->iterations += executed;
+        stats->pixels += iterations.size();
+      }
+
+      return hit;
+    }
+
+    /**
+     * @brief render renders cfg with gen's kernel and colouring, escape
+     * iterations come from the cache when present. A miss is rendered by
+     * gen.generate() (tiled, pipelined, resumed when resumable), which
+     * keeps its iterations for a queued store.
+     * @param stats - kernel time (load or compute), colorize time,
+     * iterations and pixels are added if not null
+     */
+    std::unique_ptr<bitmap_image> render(JuliaSetGenerator& gen, const JuliaSetGeneratorConfig& cfg,
+                                         RenderStats *stats = nullptr) {
+      const std::string kernel = JuliaSetGenerator::kernelName(JuliaSetGenerator::resolveKernel(gen.kernel(), cfg));
+      auto start = std::chrono::steady_clock::now();
+      std::vector<unsigned int> frame;
+
+      if (!load(cfg, kernel, frame, gen.renderPool().get())) {
+        std::unique_ptr<bitmap_image> image = gen.generate(cfg, frame, stats);
+
+        queueStore(cfg, kernel, std::move(frame));
+        return image;
+      }
+
+      if (stats) {
+        stats->kernel_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+        stats->pixels += frame.size();
+      }
+
+      start = std::chrono::steady_clock::now();
+      std::unique_ptr<bitmap_image> image(new bitmap_image(cfg.width_, cfg.height_));
+
+      gen.colorizeIterations(cfg, frame.data(), *image);
+
+      if (stats) {
+        stats->colorize_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+      }
+
+      return image;
+    }
+
+  private:
+    constexpr static const unsigned char MAGIC[4] = { 'J', 'I', 'T', 'C' };
+
+    struct PendingStore {
+      JuliaSetGeneratorConfig cfg;
+      std::string kernel;
+      std::vector<unsigned int> iterations;
+    };
+
+    /**
+     * @brief writerLoop stores queued entries (encoded on this thread, the
+     * pool stays free for rendering) until the cache is destroyed
+     */
+    void writerLoop() {
+      for (;;) {
+        PendingStore pending;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          not_empty_.wait(lock, [this] {
+            return closed_ || !queue_.empty();
+          });
+
+          // Finish what is queued even when closing
+          if (queue_.empty()) return;
+
+          pending = std::move(queue_.front());
+          queue_.pop_front();
+          storing_ = true;
+        }
+        changed_.notify_all();
+
+        store(pending.cfg, pending.kernel, pending.iterations.data());
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          storing_ = false;
+        }
+        changed_.notify_all();
+      }
+    }
+
+    static void putLE(std::vector<unsigned char>& out, std::uint64_t value, unsigned int size) {
+      for (unsigned int i = 0; i < size; ++i) out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+
+    static std::uint64_t getLE(const unsigned char *data, unsigned int size) {
+      std::uint64_t value = 0;
+
+      for (unsigned int i = 0; i < size; ++i) value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+
+      return value;
+    }
+
+    /**
+     * @brief decode checks header of entry (magic, version, full key,
+     * frame size) and decodes its iterations
+     */
+    static bool decode(const unsigned char *data, std::size_t size, const std::string& entry_key,
+                       unsigned int width, unsigned int height, std::vector<unsigned int>& iterations, RenderPool *pool) {
+      const std::size_t header = 4 + 4 + 4 + entry_key.size();
+      TiledIterations frame;
+
+      if ((size < header) || (std::memcmp(data, MAGIC, 4) != 0) || (getLE(data + 4, 4) != VERSION) ||
+          (getLE(data + 8, 4) != entry_key.size()) || (std::memcmp(data + 12, entry_key.data(), entry_key.size()) != 0) ||
+          !frame.open(data + header, size - header) || (frame.width() != width) || (frame.height() != height)) return false;
+
+      iterations.resize(static_cast<std::size_t>(width) * height);
+
+      return frame.decode(iterations.data(), pool);
+    }
+
+    void evict() {
+      std::error_code error;
+      std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path> > entries;
+      std::uint64_t total = 0;
+
+      const auto now = std::filesystem::file_time_type::clock::now();
+
+      for (std::filesystem::directory_iterator it(directory_, error), end; !error && (it != end); it.increment(error)) {
+        // Temporary files are named <entry>.tmp<random> by store()
+        const bool temporary = it->path().filename().string().find(std::string(EXTENSION) + ".tmp") != std::string::npos;
+
+        if (!temporary && (it->path().extension() != EXTENSION)) continue;
+
+        std::error_code entry_error;
+        const std::uint64_t size = it->file_size(entry_error);
+        const auto time = it->last_write_time(entry_error);
+
+        if (entry_error) continue;
+
+        if (temporary) {
+          // Younger ones may still be written by another process
+          if (now - time > STALE_TEMPORARY_AGE) std::filesystem::remove(it->path(), entry_error);
+
+          continue;
+        }
+
+        total += size;
+        entries.emplace_back(time, it->path());
+      }
+
+      if (total <= capacity_) return;
+
+      std::sort(entries.begin(), entries.end());
+
+      for (const auto& entry : entries) {
+        if (total <= capacity_) break;
+
+        std::error_code entry_error;
+        const std::uint64_t size = std::filesystem::file_size(entry.second, entry_error);
+
+        if (!entry_error && std::filesystem::remove(entry.second, entry_error)) total -= size;
+      }
+    }
+
+    std::string directory_;
+    std::uint64_t capacity_;
+
+    std::thread writer_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_,
+                            changed_; //!< queue shrank or a store finished
+    std::deque<PendingStore> queue_;
+    bool closed_,
+         storing_;
+};
+
+#endif // ITERATION_CACHE_H
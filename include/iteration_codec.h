@@ -0,0 +1,460 @@
+#ifndef ITERATION_CODEC_H
+#define ITERATION_CODEC_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <render_pool.h>
+
+/**
+ * @brief The IterationCodec class compresses escape iteration buffers
+ * for the render farm, the render daemon and the iteration cache.
+ *
+ * Julia frames are made of large areas of equal iterations (interior,
+ * fast escaping border) and of iteration bands, which vertical prediction
+ * turns into long runs of equal residuals (30-50x smaller than raw 32-bit
+ * buffers on typical views). Output is byte order independent.
+ */
+class IterationCodec {
+  public:
+    /**
+     * @brief encodeTile appends compressed iterations of a tile.
+     *
+     * Every value (plus one, so interior UINT_MAX wraps to 0) is predicted
+     * by the value above it (left in the first row), the residual is
+     * zigzag coded and runs of equal residuals - flat areas and the
+     * straight iteration bands - are merged into one token: varint of
+     * residual * 2 + (run > 1), followed by varint of run - 2 for runs.
+     *
+     * @param iterations - first row of tile, rows stride elements apart
+     */
+    static void encodeTile(const unsigned int *iterations, unsigned int columns, unsigned int rows,
+                           std::size_t stride, std::vector<unsigned char>& out) {
+      std::uint32_t residual = 0;
+      std::uint64_t run = 0;
+
+      for (unsigned int y = 0; y < rows; ++y) {
+        const unsigned int *row = iterations + y * stride;
+
+        for (unsigned int x = 0; x < columns; ++x) {
+          const std::uint32_t current = zigzag((row[x] + 1U) - predict(row, x, y, stride));
+
+          if ((run > 0) && (current == residual)) {
+            ++run;
+            continue;
+          }
+
+          putRun(out, residual, run);
+          residual = current;
+          run = 1;
+        }
+      }
+
+      putRun(out, residual, run);
+    }
+
+    /**
+     * @brief decodeTile reverses encodeTile()
+     * @param iterations - first row of tile, rows land stride elements apart
+     * @return false unless data decodes to exactly columns * rows values
+     */
+    static bool decodeTile(const unsigned char *data, const unsigned char *end,
+                           unsigned int *iterations, unsigned int columns, unsigned int rows, std::size_t stride) {
+      const std::uint64_t count = static_cast<std::uint64_t>(columns) * rows;
+      std::uint64_t position = 0;
+      unsigned int x = 0,
+                   y = 0;
+
+      while (data < end) {
+        std::uint64_t token, run = 1;
+
+        if (!getVarint(data, end, token) || (token >> 33) || ((token & 1) && !getVarint(data, end, run))) return false;
+
+        if (token & 1) run += 2;
+
+        if (run > count - position) return false;
+
+        const std::uint32_t residual = unzigzag(static_cast<std::uint32_t>(token >> 1));
+
+        for (position += run; run > 0; --run) {
+          unsigned int *row = iterations + y * stride;
+
+          row[x] = residual + predict(row, x, y, stride) - 1U;
+
+          if (++x == columns) {
+            x = 0;
+            ++y;
+          }
+        }
+      }
+
+      return position == count;
+    }
+
+    static void putVarint(std::vector<unsigned char>& out, std::uint64_t value) {
+      while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+      }
+
+      out.push_back(static_cast<unsigned char>(value));
+    }
+
+    static bool getVarint(const unsigned char *& data, const unsigned char *end, std::uint64_t& value) {
+      value = 0;
+
+      for (unsigned int shift = 0; (data < end) && (shift < 64); shift += 7) {
+        const unsigned char byte = *(data++);
+
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) return true;
+      }
+
+      return false;
+    }
+
+  private:
+    /**
+     * @brief predict
+     * @return prediction of stored value (iterations + 1) at x of row
+     */
+    static std::uint32_t predict(const unsigned int *row, unsigned int x, unsigned int y, std::size_t stride) {
+      if (y > 0) return *(row - stride + x) + 1U;
+
+      return x > 0 ? row[x - 1] + 1U : 0U;
+    }
+
+    static std::uint32_t zigzag(std::uint32_t value) {
+      return (value << 1) ^ (0U - (value >> 31));
+    }
+
+    static std::uint32_t unzigzag(std::uint32_t value) {
+      return (value >> 1) ^ (0U - (value & 1U));
+    }
+
+    static void putRun(std::vector<unsigned char>& out, std::uint32_t residual, std::uint64_t run) {
+      if (run == 0) return;
+
+      putVarint(out, (static_cast<std::uint64_t>(residual) << 1) | (run > 1 ? 1U : 0U));
+
+      if (run > 1) putVarint(out, run - 2);
+    }
+};
+
+/**
+ * @brief The TiledIterations class reads and writes the compact frame
+ * format of iteration data (julia_batch --format jit, iteration cache
+ * entries): tiles compressed independently by IterationCodec, with an
+ * offset table, so any tile can be decoded alone and tiles decode in
+ * parallel.
+ *
+ * Layout, all little-endian:
+ *
+ *     "JITF", u32 version, u32 width, u32 height, u32 tile size,
+ *     u64 offset of tile data from start of frame, per tile and one past
+ *     the last, then tile data, tiles in row-major order
+ */
+class TiledIterations {
+  public:
+    constexpr static const std::uint32_t VERSION = 1,
+                                         DEFAULT_TILE_SIZE = 128;
+    constexpr static const std::size_t FIXED_HEADER_SIZE = 4 + 4 * 4;
+
+    TiledIterations() : data_(nullptr), size_(0), width_(0), height_(0), tile_size_(0) {
+    }
+
+    /**
+     * @brief headerSize
+     * @return bytes before first tile of frame
+     */
+    static std::uint64_t headerSize(unsigned int width, unsigned int height, unsigned int tile_size) {
+      return FIXED_HEADER_SIZE + 8 * (tileCount(width, height, tile_size) + 1);
+    }
+
+    static std::uint64_t tileCount(unsigned int width, unsigned int height, unsigned int tile_size) {
+      return tileColumns(width, tile_size) * tileColumns(height, tile_size);
+    }
+
+    /**
+     * @brief tileColumns
+     * @return tiles along size (64-bit, sizes near 2^32 must not wrap)
+     */
+    static std::uint64_t tileColumns(unsigned int size, unsigned int tile_size) {
+      return (static_cast<std::uint64_t>(size) + tile_size - 1) / tile_size;
+    }
+
+    /**
+     * @brief encode compresses whole frame
+     * @param iterations - width * height iterations, row-major
+     * @param pool - encodes tiles in parallel if not null
+     */
+    static std::vector<unsigned char> encode(const unsigned int *iterations, unsigned int width, unsigned int height,
+                                             unsigned int tile_size = DEFAULT_TILE_SIZE, RenderPool *pool = nullptr) {
+      std::vector<unsigned char> out;
+      std::vector<std::vector<unsigned char> > tiles(static_cast<std::size_t>(tileCount(width, height, tile_size)));
+      const std::uint64_t tiles_x = tileColumns(width, tile_size);
+
+      auto encodeOne = [&](std::size_t index) {
+                         const unsigned int x = static_cast<unsigned int>(index % tiles_x) * tile_size,
+                                            y = static_cast<unsigned int>(index / tiles_x) * tile_size;
+
+                         IterationCodec::encodeTile(iterations + static_cast<std::size_t>(y) * width + x,
+                                                    std::min(tile_size, width - x), std::min(tile_size, height - y),
+                                                    width, tiles[index]);
+                       };
+
+      if (pool) pool->parallelFor(tiles.size(), encodeOne);
+      else for (std::size_t i = 0; i < tiles.size(); ++i) encodeOne(i);
+
+      writeHeader(out, width, height, tile_size);
+
+      std::uint64_t offset = headerSize(width, height, tile_size);
+
+      for (const std::vector<unsigned char>& tile : tiles) {
+        putLE(out, offset, 8);
+        offset += tile.size();
+      }
+
+      putLE(out, offset, 8);
+
+      for (const std::vector<unsigned char>& tile : tiles) out.insert(out.end(), tile.begin(), tile.end());
+
+      return out;
+    }
+
+    /**
+     * @brief open checks header and offset table, data is not copied and
+     * must outlive the reader (e.g. a file mapping)
+     * @return false if data is not a valid frame
+     */
+    bool open(const unsigned char *data, std::size_t size) {
+      data_ = nullptr;
+
+      if ((size < FIXED_HEADER_SIZE) || (std::memcmp(data, MAGIC, 4) != 0) || (getLE(data + 4, 4) != VERSION)) return false;
+
+      width_ = static_cast<unsigned int>(getLE(data + 8, 4));
+      height_ = static_cast<unsigned int>(getLE(data + 12, 4));
+      tile_size_ = static_cast<unsigned int>(getLE(data + 16, 4));
+
+      if ((width_ == 0) || (height_ == 0) || (tile_size_ == 0)) return false;
+
+      // Offset table (tiles + 1 entries) must fit, before headerSize() can overflow
+      if (tileCount(width_, height_, tile_size_) >= (size - FIXED_HEADER_SIZE) / 8) return false;
+
+      // Offsets must not decrease nor point outside data
+      std::uint64_t previous = headerSize(width_, height_, tile_size_);
+
+      for (std::uint64_t i = 0; i <= tileCount(width_, height_, tile_size_); ++i) {
+        const std::uint64_t offset = getLE(data + FIXED_HEADER_SIZE + 8 * i, 8);
+
+        if ((offset < previous) || (offset > size)) return false;
+
+        previous = offset;
+      }
+
+      data_ = data;
+      size_ = size;
+
+      return true;
+    }
+
+    unsigned int width() const {
+      return width_;
+    }
+
+    unsigned int height() const {
+      return height_;
+    }
+
+    unsigned int tileSize() const {
+      return tile_size_;
+    }
+
+    std::size_t tileCount() const {
+      return static_cast<std::size_t>(tileCount(width_, height_, tile_size_));
+    }
+
+    /**
+     * @brief decodeTile decodes a single tile
+     * @param index - tile index, row-major
+     * @param frame - first element of the whole frame (not of the tile)
+     * @param stride - distance between frame rows in elements
+     * @return false on corrupt tile data
+     */
+    bool decodeTile(std::size_t index, unsigned int *frame, std::size_t stride) const {
+      const std::uint64_t tiles_x = tileColumns(width_, tile_size_);
+      const unsigned int x = static_cast<unsigned int>(index % tiles_x) * tile_size_,
+                         y = static_cast<unsigned int>(index / tiles_x) * tile_size_;
+      const unsigned char *entry = data_ + FIXED_HEADER_SIZE + 8 * index;
+
+      return IterationCodec::decodeTile(data_ + getLE(entry, 8), data_ + getLE(entry + 8, 8),
+                                        frame + static_cast<std::size_t>(y) * stride + x,
+                                        std::min(tile_size_, width_ - x), std::min(tile_size_, height_ - y), stride);
+    }
+
+    /**
+     * @brief decode decodes the whole frame
+     * @param frame - receives width * height iterations, row-major
+     * @param pool - decodes tiles in parallel if not null
+     * @return false on corrupt tile data
+     */
+    bool decode(unsigned int *frame, RenderPool *pool = nullptr) const {
+      std::atomic<bool> ok(data_ != nullptr);
+
+      auto decodeOne = [&](std::size_t index) {
+                         if (!decodeTile(index, frame, width_)) ok = false;
+                       };
+
+      if (!ok) return false;
+
+      if (pool) pool->parallelFor(tileCount(), decodeOne);
+      else for (std::size_t i = 0; i < tileCount(); ++i) decodeOne(i);
+
+      return ok;
+    }
+
+  private:
+    friend class TiledIterationWriter;
+
+    constexpr static const unsigned char MAGIC[4] = { 'J', 'I', 'T', 'F' };
+
+    static void putLE(std::vector<unsigned char>& out, std::uint64_t value, unsigned int size) {
+      for (unsigned int i = 0; i < size; ++i) out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+
+    static std::uint64_t getLE(const unsigned char *data, unsigned int size) {
+      std::uint64_t value = 0;
+
+      for (unsigned int i = 0; i < size; ++i) value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+
+      return value;
+    }
+
+    static void writeHeader(std::vector<unsigned char>& out, unsigned int width, unsigned int height, unsigned int tile_size) {
+      out.insert(out.end(), MAGIC, MAGIC + 4);
+      putLE(out, VERSION, 4);
+      putLE(out, width, 4);
+      putLE(out, height, 4);
+      putLE(out, tile_size, 4);
+    }
+
+    const unsigned char *data_;
+    std::size_t size_;
+    unsigned int width_,
+                 height_,
+                 tile_size_;
+};
+
+/**
+ * @brief The TiledIterationWriter class writes a TiledIterations file
+ * band by band (one row of tiles at a time), so frames of any size are
+ * exported with one band of iterations in memory.
+ */
+class TiledIterationWriter {
+  public:
+    TiledIterationWriter(const std::string& file_name, unsigned int width, unsigned int height,
+                         unsigned int tile_size = TiledIterations::DEFAULT_TILE_SIZE)
+      : file_name_(file_name), width_(width), height_(height), tile_size_(std::max(1U, tile_size)), rows_written_(0),
+      stream_(file_name.c_str(), std::ios::binary | std::ios::trunc) {
+      if (!stream_) {
+        std::cerr << "TiledIterationWriter::TiledIterationWriter(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return;
+      }
+
+      std::vector<unsigned char> header;
+
+      TiledIterations::writeHeader(header, width_, height_, tile_size_);
+      // Offset table is filled in by close()
+      header.resize(static_cast<std::size_t>(TiledIterations::headerSize(width_, height_, tile_size_)), 0);
+      stream_.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+      offsets_.push_back(header.size());
+    }
+
+    inline bool operator!() const {
+      return !stream_;
+    }
+
+    /**
+     * @brief bandRows
+     * @return rows of next band, 0 when frame is complete
+     */
+    unsigned int bandRows() const {
+      return std::min(tile_size_, height_ - rows_written_);
+    }
+
+    unsigned int bandTop() const {
+      return rows_written_;
+    }
+
+    /**
+     * @brief writeBand compresses and appends next band of tiles
+     * @param band - bandRows() rows of width iterations
+     * @param pool - encodes tiles in parallel if not null
+     */
+    bool writeBand(const unsigned int *band, RenderPool *pool = nullptr) {
+      const unsigned int rows = bandRows();
+      const std::size_t tiles_x = static_cast<std::size_t>(TiledIterations::tileColumns(width_, tile_size_));
+      std::vector<std::vector<unsigned char> > tiles(tiles_x);
+
+      if (!stream_ || (rows == 0)) return false;
+
+      auto encodeOne = [&](std::size_t index) {
+                         const unsigned int x = static_cast<unsigned int>(index) * tile_size_;
+
+                         IterationCodec::encodeTile(band + x, std::min(tile_size_, width_ - x), rows, width_, tiles[index]);
+                       };
+
+      if (pool) pool->parallelFor(tiles.size(), encodeOne);
+      else for (std::size_t i = 0; i < tiles.size(); ++i) encodeOne(i);
+
+      for (const std::vector<unsigned char>& tile : tiles) {
+        stream_.write(reinterpret_cast<const char *>(tile.data()), static_cast<std::streamsize>(tile.size()));
+        offsets_.push_back(offsets_.back() + tile.size());
+      }
+
+      rows_written_ += rows;
+
+      return stream_.good();
+    }
+
+    /**
+     * @brief close writes offset table
+     * @return false if frame is incomplete or writing failed
+     */
+    bool close() {
+      if (!stream_ || (rows_written_ != height_)) {
+        std::cerr << "TiledIterationWriter::close(): Error - Incomplete or failed file " << file_name_ << "!" << std::endl;
+        return false;
+      }
+
+      std::vector<unsigned char> table;
+
+      for (const std::uint64_t offset : offsets_) TiledIterations::putLE(table, offset, 8);
+
+      stream_.seekp(static_cast<std::streamoff>(TiledIterations::FIXED_HEADER_SIZE));
+      stream_.write(reinterpret_cast<const char *>(table.data()), static_cast<std::streamsize>(table.size()));
+      stream_.close();
+
+      return !stream_.fail();
+    }
+
+  private:
+    std::string file_name_;
+    unsigned int width_,
+                 height_,
+                 tile_size_,
+                 rows_written_;
+    std::ofstream stream_;
+    std::vector<std::uint64_t> offsets_;
+};
+
+#endif // ITERATION_CODEC_H
@@ -1,10 +1,27 @@
 #ifndef JULIA_SET_GENERATOR_H
 #define JULIA_SET_GENERATOR_H
 
+#include <algorithm>
 #include <memory>
 #include <complex>
+#include <cmath>
+#include <numeric>
+#include <vector>
 #include <limits>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
 #include <bitmap_image.hpp>
+#include <render_pool.h>
+#include <bounded_queue.h>
+#include <bmp_strip_writer.h>
+#include <mapped_bitmap_image.h>
+#include <render_stats.h>
+#include <render_profile.h>
+#include <render_trace.h>
+#include <double_double.h>
+#include <fixed_point.h>
 
 class JuliaSetGenerator;
 
@@ -69,7 +86,194 @@ struct JuliaSetGeneratorConfig {
  */
 class JuliaSetGenerator {
   private:
+    constexpr static const unsigned int MAX_BAND_PIXELS = 4 * 1024 * 1024,
+                                        TILE_SIZE = 64;
+
     JuliaSetGeneratorConfig cfg_;
+    std::shared_ptr<RenderPool> pool_;
+
+  public:
+    /**
+     * @brief Number of pixels iterated side by side by computeLaneIterations()
+     * (one AVX register of doubles)
+     */
+    constexpr static const unsigned int BATCH_LANES = 4;
+
+    /**
+     * @brief iterationBytes element size of internal iteration buffers of
+     * cfg: escape iterations (below max iterations) must fit beside the
+     * interior bit
+     * @return 1 up to 128 max iterations, 2 up to 32768, 4 above
+     */
+    static unsigned int iterationBytes(const JuliaSetGeneratorConfig& cfg) {
+      if (cfg.max_iterations_ <= IterationCell<std::uint8_t>::INTERIOR) return 1;
+      if (cfg.max_iterations_ <= IterationCell<std::uint16_t>::INTERIOR) return 2;
+
+      return 4;
+    }
+
+    /**
+     * @brief The TileSchedule enum selects order in which kernel tiles
+     * are handed out to pool threads
+     */
+    enum class TileSchedule {
+      RowMajor,     //!< top-left to bottom-right
+      LongestFirst  //!< most expensive estimated tiles first (LPT)
+    };
+
+    /**
+     * @brief The Kernel enum selects escape-time arithmetic
+     */
+    enum class Kernel {
+      Auto,          //!< Double, DoubleDouble when pixel spacing is below double resolution
+      Double,        //!< 53-bit double
+      DoubleDouble,  //!< ~106-bit double-double, about 1e13 - 1e30 zoom
+      FixedPoint64,  //!< Q7.56 integer, bit-exact on every compiler and CPU (Double if view exceeds range)
+      FixedPoint128  //!< Q7.120 integer, bit-exact, resolution 2^-120 (Double if view exceeds range)
+    };
+
+    /**
+     * @brief The Coloring enum selects mapping of escape iterations to
+     * jet_colormap
+     */
+    enum class Coloring {
+      Linear,             //!< colour index proportional to iterations / max iterations
+      HistogramEqualized  //!< colour index proportional to share of pixels escaping earlier
+    };
+
+    /**
+     * @brief The InteriorTrap struct is a disk around one point of the
+     * attracting cycle of c (interiorTrap()). Its image after period
+     * iterations lies inside it, so an orbit entering it never escapes.
+     * Period 0 means no trap (c has no attracting cycle, or it was not found).
+     */
+    struct InteriorTrap {
+      unsigned int period = 0;
+      double real = 0.0,
+             imag = 0.0,
+             radius_2 = 0.0; //!< squared radius
+      double multiplier = 0.0; //!< |(f^period)'| on the cycle
+    };
+
+  private:
+    /**
+     * @brief Relative pixel spacing below which Kernel::Auto switches to
+     * double-double: 2^-44 leaves 8 bits of margin for rounding error
+     * growth along the orbit
+     */
+    constexpr static const double DOUBLE_SPACING_LIMIT = 1.0 / (1ULL << 44);
+
+    /**
+     * @brief Magnitude every value of the fixed-point kernels must stay
+     * below: Q7 integer part holds +-128, one less absorbs rounding
+     */
+    constexpr static const double FIXED_POINT_LIMIT = 127.0;
+
+    /**
+     * @brief The TileCosts struct holds measured per-tile iteration
+     * counts of last rendered region, cost model of the next frame
+     */
+    struct TileCosts {
+      unsigned int first_column = 0,
+                   first_row = 0,
+                   width = 0,
+                   height = 0;
+      JuliaSetGeneratorConfig cfg;
+      std::vector<std::uint64_t> cost;
+    };
+
+    /**
+     * @brief Histogram of escaped pixels has at most this many bins,
+     * iterations are shifted right to fit
+     */
+    constexpr static const unsigned int MAX_HISTOGRAM_BINS = 1 << 16;
+
+    /**
+     * @brief Equalized palettes count a grid of at least this many pixels,
+     * every paletteStride()-th row and column, at most one pixel in
+     * MAX_PALETTE_STRIDE * MAX_PALETTE_STRIDE
+     */
+    constexpr static const unsigned int PALETTE_SAMPLES = 1 << 14,
+                                        MAX_PALETTE_STRIDE = 8;
+
+    /**
+     * @brief The Palette struct is a colour lookup table indexed by
+     * escape iterations >> shift (linear or histogram equalized mapping)
+     */
+    struct Palette {
+      unsigned int shift = 0;
+      std::vector<rgb_t> colors;
+    };
+
+    /**
+     * @brief The IterationCell struct describes element type T of internal
+     * iteration buffers: escape iteration in the low bits, interior flagged
+     * by the top bit for uint8_t / uint16_t (packed interior bit), UINT_MAX
+     * for unsigned int
+     */
+    template <typename T>
+    struct IterationCell {
+      constexpr static const T INTERIOR = (sizeof(T) < sizeof(unsigned int))
+                                          ? static_cast<T>(T(1) << (8 * sizeof(T) - 1))
+                                          : std::numeric_limits<T>::max();
+
+      static T pack(unsigned int iterations) {
+        return (iterations == std::numeric_limits<unsigned int>::max()) ? INTERIOR : static_cast<T>(iterations);
+      }
+
+      static bool interior(T cell) {
+        return cell >= INTERIOR;
+      }
+
+      static unsigned int unpack(T cell) {
+        return interior(cell) ? std::numeric_limits<unsigned int>::max() : cell;
+      }
+    };
+
+    /**
+     * @brief The FramePalette struct caches palette of the sampled frame
+     * histogram, shared by all strips / tiles of one frame
+     */
+    struct FramePalette {
+      JuliaSetGeneratorConfig cfg;
+      Kernel kernel = Kernel::Auto;
+      Palette palette;
+    };
+
+    /**
+     * @brief The ResumeState struct keeps the last computeFrameIterations()
+     * frame: iterations of every pixel and final z of pixels that reached
+     * max iterations, from which a higher max iterations continues
+     */
+    struct ResumeState {
+      struct Capped {
+        std::size_t pixel;
+        double z_real,
+               z_imag;
+      };
+
+      JuliaSetGeneratorConfig cfg;
+      std::vector<unsigned int> iterations;
+      std::vector<Capped> capped;
+    };
+
+    /**
+     * @brief Critical orbit iterations before cycle detection, longest
+     * detected cycle and Newton steps refining its point
+     */
+    constexpr static const unsigned int CYCLE_TRANSIENT = 1 << 14,
+                                        MAX_CYCLE_PERIOD = 1024,
+                                        CYCLE_NEWTON_STEPS = 32;
+
+    TileSchedule schedule_ = TileSchedule::LongestFirst;
+    Kernel kernel_ = Kernel::Auto;
+    Coloring coloring_ = Coloring::Linear;
+    bool pipelined_ = true;
+    bool resumable_ = false;
+    bool cycle_detection_ = true;
+    TileCosts tile_costs_;
+    FramePalette frame_palette_;
+    ResumeState resume_;
 
   public:
     /**
@@ -77,7 +281,7 @@ class JuliaSetGenerator {
      *
      * For default values please refer to public static constants of JuliaSetGenerator
      */
-    JuliaSetGenerator() : cfg_() {
+    JuliaSetGenerator() : cfg_(), pool_(RenderPool::global()) {
     }
 
     /**
@@ -97,7 +301,8 @@ class JuliaSetGenerator {
                       double       c_realis,
                       double       c_imaginalis,
                       unsigned int max_iterations)
-      : cfg_(width, height, c_realis, c_imaginalis, max_iterations) {
+      : cfg_(width, height, c_realis, c_imaginalis, max_iterations),
+      pool_(RenderPool::global()) {
     }
 
     /**
@@ -121,6 +326,14 @@ class JuliaSetGenerator {
       if (imaginalis_max) *imaginalis_max = getComplexPlaneImaginalisCoordinate(cfg_.height_, cfg_);
     }
 
+    /**
+     * @brief getConfig
+     * @return currently set generator configuration
+     */
+    const JuliaSetGeneratorConfig& getConfig() const {
+      return cfg_;
+    }
+
     /**
      * @brief setWidth
      * @param width - - output bitmap width in pixels
@@ -205,129 +418,1786 @@ class JuliaSetGenerator {
     }
 
     /**
-     * @brief generate
-     * @return unique pointer to generated julia set image
+     * @brief setRenderPool
+     * @param pool - thread pool used for rendering, nullptr restores global pool
+     * @return reference for "this"
      */
-    std::unique_ptr<bitmap_image> generate() {
-      using namespace std::complex_literals;
+    JuliaSetGenerator& setRenderPool(std::shared_ptr<RenderPool> pool) {
+      pool_ = pool ? std::move(pool) : RenderPool::global();
+      return *this;
+    }
 
-      JuliaSetGeneratorConfig local_cfg = cfg_;
+    /**
+     * @brief renderPool
+     * @return thread pool used for rendering
+     */
+    std::shared_ptr<RenderPool> renderPool() const {
+      return pool_;
+    }
+
+    /**
+     * @brief setTileSchedule
+     * @param schedule - kernel tile order, LongestFirst by default
+     * @return reference for "this"
+     */
+    JuliaSetGenerator& setTileSchedule(TileSchedule schedule) {
+      schedule_ = schedule;
+      return *this;
+    }
 
-      auto fractal = std::make_unique<bitmap_image>(local_cfg.width_, local_cfg.height_);
+    /**
+     * @brief setPipelined
+     * @param pipelined - colourize tiles while remaining tiles are still
+     * computed (default), or in a separate pass after all of them
+     * @return reference for "this"
+     */
+    JuliaSetGenerator& setPipelined(bool pipelined) {
+      pipelined_ = pipelined;
+      return *this;
+    }
+
+    /**
+     * @brief setResumable
+     * @param resumable - computeFrameIterations() keeps iterations and
+     * final z of capped pixels of its last frame, so the same view with
+     * higher max iterations only iterates those pixels further (double
+     * kernel only). Costs 4 bytes per pixel plus 24 per capped pixel.
+     * @return reference for "this"
+     */
+    JuliaSetGenerator& setResumable(bool resumable) {
+      resumable_ = resumable;
 
-      for (unsigned int y = 0; y < local_cfg.height_; ++y) {
-        // Compute imaginalis coordinate on complex plane
-        double coord_imag = getComplexPlaneImaginalisCoordinate(y, local_cfg);
+      if (!resumable_) resume_ = ResumeState();
 
-        for (unsigned int x = 0; x < local_cfg.width_; ++x) {
-          unsigned int it = computeCoordinateIterations(
-              getComplexPlaneRealCoordinate(x, local_cfg),
-              coord_imag,
-              local_cfg);
+      return *this;
+    }
 
-          if (it < std::numeric_limits<unsigned int>::max()) {
-            fractal->set_pixel(x, y, iterationsToColor(it, local_cfg));
-          }
+    bool resumable() const {
+      return resumable_;
+    }
+
+    /**
+     * @brief setCycleDetection
+     * @param detection - double kernel stops iterating pixels whose orbit
+     * enters the interiorTrap() of c (default), they are interior
+     * @return reference for "this"
+     */
+    JuliaSetGenerator& setCycleDetection(bool detection) {
+      cycle_detection_ = detection;
+      return *this;
+    }
+
+    bool cycleDetection() const {
+      return cycle_detection_;
+    }
+
+    /**
+     * @brief interiorTrap finds the attracting cycle of c from the
+     * critical orbit of 0 and a disk around one of its points that orbits
+     * never leave.
+     *
+     * After CYCLE_TRANSIENT iterations the period is the first return of
+     * the orbit close to its start, the cycle point is refined by Newton's
+     * method on f^p(z) - z. The radius r is proven by interval arithmetic:
+     * an orbit within r_k of cycle point z_k is within
+     * r_k * (2|z_k| + r_k) of z_k+1, the largest r (halved from 1) whose
+     * bound after one period is below r * (1 + multiplier) / 2 is taken,
+     * with every disk inside |z| < 2. The contraction margin also covers
+     * rounding of the kernel, so trapped pixels would never have escaped.
+     *
+     * @param cfg - generator config, only c is used
+     * @return trap, period 0 if there is no attracting cycle
+     */
+    static InteriorTrap interiorTrap(const JuliaSetGeneratorConfig& cfg) {
+      const std::complex<double> c(cfg.c_realis_, cfg.c_imaginalis_);
+      std::complex<double> z(0.0, 0.0);
+      InteriorTrap trap;
+
+      for (unsigned int i = 0; i < CYCLE_TRANSIENT; ++i) {
+        z = z * z + c;
+
+        if (std::norm(z) >= 4.0) return trap;
+      }
+
+      // Period: first return close to z
+      std::complex<double> w = z;
+      unsigned int period = 0;
+
+      for (unsigned int p = 1; (p <= MAX_CYCLE_PERIOD) && !period; ++p) {
+        w = w * w + c;
+
+        if (std::norm(w - z) < 1e-12) period = p;
+      }
+
+      if (!period) return trap;
+
+      for (unsigned int step = 0; step < CYCLE_NEWTON_STEPS; ++step) {
+        std::complex<double> f = z,
+                             derivative(1.0, 0.0);
+
+        for (unsigned int k = 0; k < period; ++k) {
+          derivative *= 2.0 * f;
+          f = f * f + c;
+        }
+
+        const std::complex<double> delta = (f - z) / (derivative - 1.0);
+
+        z -= delta;
+
+        if (std::norm(delta) < 1e-30) break;
+      }
+
+      // Cycle points, multiplier and closing error of one period
+      std::vector<std::complex<double> > cycle(period + 1, z);
+      double multiplier = 1.0;
+
+      for (unsigned int k = 0; k < period; ++k) {
+        multiplier *= 2.0 * std::abs(cycle[k]);
+        cycle[k + 1] = cycle[k] * cycle[k] + c;
+      }
+
+      const double closing = std::abs(cycle[period] - z);
+
+      if (!(multiplier < 1.0) || !(closing < 1e-9)) return trap;
+
+      const double contraction = 0.5 * (1.0 + multiplier);
+
+      for (double radius = 1.0; radius > 1e-12; radius *= 0.5) {
+        double r = radius;
+        bool inside = true;
+
+        for (unsigned int k = 0; (k < period) && inside; ++k) {
+          inside = std::abs(cycle[k]) + r < 2.0;
+          // Relative and absolute margin for rounding of this bound
+          r = r * (2.0 * std::abs(cycle[k]) + r) * (1.0 + 1e-12) + 1e-15;
+        }
+
+        if (inside && (r + closing <= contraction * radius)) {
+          trap.period = period;
+          trap.real = z.real();
+          trap.imag = z.imag();
+          trap.radius_2 = radius * radius;
+          trap.multiplier = multiplier;
+          break;
         }
       }
 
-      return fractal;
+      return trap;
     }
 
-  private:
+    /**
+     * @brief threadCount
+     * @return number of threads rendering a frame
+     */
+    unsigned int threadCount() const {
+      return pool_->threadCount();
+    }
 
+    /**
+     * @brief setKernel
+     * @param kernel - escape-time arithmetic, Auto by default
+     * @return reference for "this"
+     */
+    JuliaSetGenerator& setKernel(Kernel kernel) {
+      kernel_ = kernel;
+      return *this;
+    }
 
     /**
-     * @brief iterationsToColor
-     * @param iterations
-     * @param cfg
-     * @return
+     * @brief setColoring
+     * @param coloring - iterations to colour mapping, Linear by default
+     * @return reference for "this"
      */
-    rgb_t iterationsToColor(unsigned int iterations, const JuliaSetGeneratorConfig& cfg) {
-      if (iterations != std::numeric_limits<unsigned int>::max()) {
-        unsigned int color_index = static_cast<unsigned int>((1000.0 * iterations) / cfg.max_iterations_);
+    JuliaSetGenerator& setColoring(Coloring coloring) {
+      coloring_ = coloring;
+      return *this;
+    }
 
-        if (color_index > 1000) color_index = 1000;
+    Coloring coloring() const {
+      return coloring_;
+    }
 
-        return jet_colormap[color_index];
-      }
+    Kernel kernel() const {
+      return kernel_;
+    }
 
-      return { 0, 0, 0 };
+    /**
+     * @brief kernelName
+     * @return name of escape-time kernel used for current config
+     */
+    const char *kernelName() const {
+      return kernelName(cfg_);
     }
 
     /**
-     * @brief computeCoordinateIterations
-     * @param coord_real
-     * @param coord_imag
-     * @param cfg
-     * @return
+     * @brief kernelName
+     * @return name of escape-time kernel used for given config
      */
-    unsigned int computeCoordinateIterations(double coord_real, double coord_imag, const JuliaSetGeneratorConfig& cfg) {
-      using namespace std::complex_literals;
+    const char *kernelName(const JuliaSetGeneratorConfig& cfg) const {
+      return kernelName(resolveKernel(kernel_, cfg));
+    }
 
-      // Equation:
-      // z_1 = z_0^2+c
+    static const char *kernelName(Kernel kernel) {
+      switch (kernel) {
+        case Kernel::DoubleDouble:
+          return "double_double";
 
-      const double c_real = cfg.c_realis_;
-      const double c_imag = cfg.c_imaginalis_;
+        case Kernel::FixedPoint64:
+          return "fixed64";
 
+        case Kernel::FixedPoint128:
+          return "fixed128";
 
-      // z_0 coordinates for first iteration
-      double z_0_imag = coord_imag;
-      double z_0_real = coord_real;
+        case Kernel::Double:
+          return "scalar_double";
 
-      // Helper optimisation variables
-      double z_0_real_2, // squared z_0_real
-             z_0_imag_2; // squared z_0_imag
+        default:
+          return "auto";
+      }
+    }
 
-      unsigned int max_i = cfg.max_iterations_;
+    /**
+     * @brief kernelFromName
+     * @param name - kernelName() result
+     * @param kernel - set on success
+     * @return false for unknown name
+     */
+    static bool kernelFromName(const std::string& name, Kernel& kernel) {
+      for (Kernel candidate : { Kernel::Auto, Kernel::Double, Kernel::DoubleDouble,
+                                Kernel::FixedPoint64, Kernel::FixedPoint128 }) {
+        if (name == kernelName(candidate)) {
+          kernel = candidate;
+          return true;
+        }
+      }
 
-      // Iterate ....
-      for (unsigned int i = 0; i < max_i; ++i) {
-        // Compute squared parts
-        z_0_real_2 = z_0_real * z_0_real;
-        z_0_imag_2 = z_0_imag * z_0_imag;
+      return false;
+    }
 
-        // compute z_1 values and store it in z_0 for next iteration.
-        //
-        // Normally it could take two steps:
-        // 1. compute z_1
-        // 2. shift z_1 to z_0
-        // This is optimized version. z_1 is only needed in next step as z_0.
-        z_0_imag = 2 * z_0_real * z_0_imag + c_imag;
-        z_0_real = z_0_real_2 - z_0_imag_2 + c_real;
+    /**
+     * @brief coloringName
+     * @return name of current colouring (julia_batch --coloring value)
+     */
+    const char *coloringName() const {
+      return coloringName(coloring_);
+    }
 
-        // Stop condition |z_1| >= 2
-        if ( (z_0_real_2 + z_0_imag_2) >= 4.0) {
-          return i;
+    static const char *coloringName(Coloring coloring) {
+      return coloring == Coloring::HistogramEqualized ? "equalized" : "linear";
+    }
+
+    /**
+     * @brief coloringFromName
+     * @param name - coloringName() result
+     * @param coloring - set on success
+     * @return false for unknown name
+     */
+    static bool coloringFromName(const std::string& name, Coloring& coloring) {
+      for (Coloring candidate : { Coloring::Linear, Coloring::HistogramEqualized }) {
+        if (name == coloringName(candidate)) {
+          coloring = candidate;
+          return true;
         }
       }
 
-      return std::numeric_limits<unsigned int>::max();
+      return false;
     }
 
     /**
-     * @brief getComplexPlaneRealCoordinate maps pixel x coord. on drawing
-     * to real part coordinate on complex plane
-     * @param pixel_x
-     * @param cfg generator config
-     * @return real part of coordinate in complex plane
+     * @brief resolveKernel
+     * @param kernel - requested kernel
+     * @param cfg - generator config
+     * @return kernel, Auto replaced by the cheapest one resolving pixels of cfg,
+     * fixed-point replaced by Double when values of cfg exceed its range
      */
-    inline static double getComplexPlaneRealCoordinate(double                         pixel_x,
-                                                       const JuliaSetGeneratorConfig& cfg) {
-      return (cfg.w2h_) * 2.0 * ((2.0 * pixel_x) / cfg.width_ - 1.0) * cfg.zoom_ + cfg.off_x_;
+    static Kernel resolveKernel(Kernel kernel, const JuliaSetGeneratorConfig& cfg) {
+      if ((kernel == Kernel::FixedPoint64) || (kernel == Kernel::FixedPoint128)) {
+        return fixedPointFits(cfg) ? kernel : Kernel::Double;
+      }
+
+      if (kernel != Kernel::Auto) return kernel;
+
+      if (cfg.height_ == 0) return Kernel::Double;
+
+      // Pixel spacing is the same along both axes: 4 * zoom / height
+      const double spacing = 4.0 * std::abs(cfg.zoom_) / cfg.height_;
+      const double magnitude = std::max({ 2.0, std::abs(cfg.off_x_), std::abs(cfg.off_y_) });
+
+      return spacing < magnitude * DOUBLE_SPACING_LIMIT ? Kernel::DoubleDouble : Kernel::Double;
     }
 
     /**
-     * @brief getComplexPlaneImaginalisCoordinate  maps pixel Y coord. on drawing
-     * to imaginalis part coordinate on complex plane
-     * @param pixel_y
-     * @param cfg generator config
-     * @return imaginalis part of coordinate in complex plane
+     * @brief fixedPointFits checks that no value of the fixed-point kernels
+     * reaches FIXED_POINT_LIMIT for cfg. The first step squares the pixel
+     * coordinate (at most the farthest view corner) and adds c; later steps
+     * start from |z| < 2, so square and sum stay below (4 + |c|)^2 + |c|.
+     * @param cfg - generator config
+     * @return true when fixed-point kernels render cfg without overflow
      */
-    inline static double getComplexPlaneImaginalisCoordinate(double                         pixel_y,
-                                                             const JuliaSetGeneratorConfig& cfg) {
-      return 2.0 * ((2.0 * pixel_y) / cfg.height_ - 1.0) * cfg.zoom_ - cfg.off_y_;
+    static bool fixedPointFits(const JuliaSetGeneratorConfig& cfg) {
+      const double corner_real = 2.0 * std::abs(cfg.zoom_) * cfg.w2h_ + std::abs(cfg.off_x_);
+      const double corner_imag = 2.0 * std::abs(cfg.zoom_) + std::abs(cfg.off_y_);
+      const double c = std::hypot(cfg.c_realis_, cfg.c_imaginalis_);
+      const double first_2 = corner_real * corner_real + corner_imag * corner_imag;
+      const double next_2 = (4.0 + c) * (4.0 + c);
+
+      // NaN fails the comparison as well
+      return std::max(first_2, next_2) + c < FIXED_POINT_LIMIT;
+    }
+
+    /**
+     * @brief generate
+     * @param stats - optional, kernel/colorize timings and counters are added to it
+     * @param profile - optional, filled with per-pixel iterations and per-tile cost
+     * @return unique pointer to generated julia set image
+     */
+    std::unique_ptr<bitmap_image> generate(RenderStats *stats = nullptr, RenderProfile *profile = nullptr) {
+      return generate(cfg_, stats, profile);
+    }
+
+    /**
+     * @brief generate renders given config instead of the generator one
+     * (e.g. reduced resolution preview of the same view)
+     * @param cfg - config to render
+     * @param stats - optional, kernel/colorize timings and counters are added to it
+     * @param profile - optional, filled with per-pixel iterations and per-tile cost
+     * @return unique pointer to generated julia set image
+     */
+    std::unique_ptr<bitmap_image> generate(const JuliaSetGeneratorConfig& cfg, RenderStats *stats = nullptr,
+                                           RenderProfile *profile = nullptr) {
+      const JuliaSetGeneratorConfig local_cfg = cfg;
+
+      auto image = std::make_unique<bitmap_image>(local_cfg.width_, local_cfg.height_);
+
+      if (profile) {
+        profile->reset(local_cfg.width_, local_cfg.height_, TILE_SIZE, local_cfg.max_iterations_,
+                       pool_->threadCount());
+      }
+
+      renderRegion(0, 0, *image, local_cfg, stats, profile);
+
+      return image;
+    }
+
+    /**
+     * @brief generate renders cfg as above and keeps escape iterations of
+     * the frame (e.g. for IterationCache). When resumable, a frame that
+     * differs from the previous one only by higher max iterations resumes
+     * its capped pixels (computeFrameIterations()); any other frame is
+     * rendered and kept for the next one to resume.
+     * @param cfg - config to render
+     * @param iterations - receives width * height iterations, row-major
+     * @param stats - optional, kernel/colorize timings and counters are added to it
+     * @return unique pointer to generated julia set image
+     */
+    std::unique_ptr<bitmap_image> generate(const JuliaSetGeneratorConfig& cfg, std::vector<unsigned int>& iterations,
+                                           RenderStats *stats = nullptr) {
+      using clock = std::chrono::steady_clock;
+
+      const JuliaSetGeneratorConfig local_cfg = cfg;
+
+      auto image = std::make_unique<bitmap_image>(local_cfg.width_, local_cfg.height_);
+
+      iterations.resize(static_cast<std::size_t>(local_cfg.width_) * local_cfg.height_);
+
+      if (!resumes(local_cfg)) {
+        renderRegion(0, 0, *image, local_cfg, stats, nullptr, iterations.data());
+        return image;
+      }
+
+      const auto start = clock::now();
+      const std::uint64_t executed = computeFrameIterations(local_cfg, iterations.data());
+      const auto colorize_start = clock::now();
+
+      colorizeIterations(local_cfg, iterations.data(), *image);
+
+      if (stats) {
+        stats->kernel_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(colorize_start - start).count();
+        stats->colorize_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - colorize_start).count();
+        stats->iterations += executed;
+        stats->pixels += iterations.size();
+      }
+
+      return image;
+    }
+
+    /**
+     * @brief generateRows renders horizontal strip of the full image
+     * @param first_row - first row of strip (top-down)
+     * @param rows - strip height, clipped to image height
+     * @param stats - optional, kernel/colorize timings and counters are added to it
+     * @return unique pointer to image of full width and strip height
+     */
+    std::unique_ptr<bitmap_image> generateRows(unsigned int first_row, unsigned int rows,
+                                               RenderStats *stats = nullptr) {
+      JuliaSetGeneratorConfig local_cfg = cfg_;
+
+      if (first_row >= local_cfg.height_) rows = 0;
+      else if (rows > local_cfg.height_ - first_row) rows = local_cfg.height_ - first_row;
+
+      auto strip = std::make_unique<bitmap_image>(local_cfg.width_, rows);
+
+      renderRows(first_row, *strip, local_cfg, stats);
+
+      return strip;
+    }
+
+    /**
+     * @brief generateRegion renders rectangular part of the full image
+     * @param first_column - left edge of region
+     * @param first_row - top edge of region
+     * @param columns - region width, clipped to image width
+     * @param rows - region height, clipped to image height
+     * @return unique pointer to image of region size
+     */
+    std::unique_ptr<bitmap_image> generateRegion(unsigned int first_column, unsigned int first_row,
+                                                 unsigned int columns, unsigned int rows) {
+      JuliaSetGeneratorConfig local_cfg = cfg_;
+
+      if (first_column >= local_cfg.width_) columns = 0;
+      else if (columns > local_cfg.width_ - first_column) columns = local_cfg.width_ - first_column;
+
+      if (first_row >= local_cfg.height_) rows = 0;
+      else if (rows > local_cfg.height_ - first_row) rows = local_cfg.height_ - first_row;
+
+      auto region = std::make_unique<bitmap_image>(columns, rows);
+
+      renderRegion(first_column, first_row, *region, local_cfg);
+
+      return region;
+    }
+
+    /**
+     * @brief generateBatch renders one image per constant c on the shared
+     * pixel grid (size, zoom, offset and max iterations of current config),
+     * for parameter sweeps and thumbnails.
+     *
+     * One parallelFor() over (constant, row) work items covers the whole
+     * batch, so small images do not pay a pool round trip each. Rows of the
+     * double kernel go through computeLaneIterations(), BATCH_LANES pixels
+     * side by side with escaped lanes refilled, pixel coordinates are
+     * computed once for all constants, and every constant has its own
+     * interiorTrap(). Deep zooms that need another kernel use the row
+     * kernel of each constant. Rows are colourized straight into the
+     * images through one linear palette, or with Coloring::HistogramEqualized
+     * through a palette of each constant, counted over the framePalette()
+     * grid in a pre-pass of the same parallelFor() shape.
+     *
+     * Images are the same as generate() with c set to each constant.
+     *
+     * @param constants - c values, one image each
+     * @param stats - optional, kernel timing and counters are added to it
+     * @return images in constants order
+     */
+    std::vector<std::unique_ptr<bitmap_image> > generateBatch(const std::vector<std::complex<double> >& constants,
+                                                              RenderStats *stats = nullptr) {
+      using clock = std::chrono::steady_clock;
+
+      const JuliaSetGeneratorConfig local_cfg = cfg_;
+      const unsigned int width = local_cfg.width_;
+      const unsigned int height = local_cfg.height_;
+      std::vector<std::unique_ptr<bitmap_image> > images;
+
+      for (std::size_t i = 0; i < constants.size(); ++i) images.push_back(std::make_unique<bitmap_image>(width, height));
+
+      if (constants.empty() || (width == 0) || (height == 0)) return images;
+
+      RenderTraceScope trace("batch", "kernel", "images", static_cast<std::int64_t>(constants.size()));
+
+      const Kernel kernel = resolveKernel(kernel_, local_cfg);
+      const bool equalize = (coloring_ == Coloring::HistogramEqualized);
+      const Palette linear = equalize ? Palette() : linearPalette(local_cfg);
+      std::vector<Palette> palettes(equalize ? constants.size() : 0);
+      std::vector<double> coord_real(width);
+      std::vector<InteriorTrap> traps(constants.size());
+      std::vector<std::vector<unsigned int> > rows(pool_->threadCount(), std::vector<unsigned int>(width));
+      std::atomic<std::uint64_t> total_iterations(0);
+
+      for (unsigned int x = 0; x < width; ++x) coord_real[x] = getComplexPlaneRealCoordinate(x, local_cfg);
+
+      const auto start = clock::now();
+
+      pool_->parallelFor(constants.size(), [&](std::size_t c) {
+        JuliaSetGeneratorConfig constant_cfg = local_cfg;
+
+        constant_cfg.c_realis_ = constants[c].real();
+        constant_cfg.c_imaginalis_ = constants[c].imag();
+        traps[c] = interiorTrap(kernel, constant_cfg);
+      });
+
+      if (equalize) {
+        const unsigned int stride = paletteStride(local_cfg);
+        const unsigned int shift = histogramShift(local_cfg);
+        const std::size_t sample_rows = (height + stride - 1) / stride,
+                          sample_columns = (width + stride - 1) / stride;
+        std::vector<unsigned int> samples(constants.size() * sample_rows * sample_columns);
+
+        pool_->parallelFor(constants.size() * sample_rows, [&](std::size_t item) {
+          const std::size_t c = item / sample_rows;
+          JuliaSetGeneratorConfig constant_cfg = local_cfg;
+
+          constant_cfg.c_realis_ = constants[c].real();
+          constant_cfg.c_imaginalis_ = constants[c].imag();
+          computeSampleIterations(static_cast<unsigned int>(item % sample_rows) * stride, stride,
+                                  &samples[item * sample_columns], kernel, traps[c], constant_cfg);
+        });
+
+        pool_->parallelFor(constants.size(), [&](std::size_t c) {
+          std::vector<std::uint64_t> histogram((local_cfg.max_iterations_ >> shift) + 1);
+
+          countIterations(&samples[c * sample_rows * sample_columns],
+                          static_cast<unsigned int>(sample_rows * sample_columns), 1, shift, histogram);
+          palettes[c] = cumulativePalette(histogram, shift);
+        });
+      }
+
+      pool_->parallelFor(constants.size() * height, [&](std::size_t item) {
+        const std::size_t c = item / height;
+        const unsigned int y = static_cast<unsigned int>(item % height);
+        std::vector<unsigned int>& row = rows[RenderPool::currentThreadIndex()];
+        JuliaSetGeneratorConfig constant_cfg = local_cfg;
+        std::uint64_t executed;
+
+        constant_cfg.c_realis_ = constants[c].real();
+        constant_cfg.c_imaginalis_ = constants[c].imag();
+
+        if (kernel == Kernel::Double) {
+          executed = computeLaneIterations(coord_real.data(), getComplexPlaneImaginalisCoordinate(y, constant_cfg),
+                                           width, row.data(), traps[c], constant_cfg);
+        } else {
+          executed = computeRowIterations(y, 0, width, row.data(), kernel, traps[c], constant_cfg);
+        }
+
+        colorizeRow(row.data(), width, images[c]->row(y), equalize ? palettes[c] : linear, constant_cfg);
+        total_iterations += executed;
+      });
+
+      if (stats) {
+        stats->kernel_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        stats->iterations += total_iterations;
+        stats->pixels += static_cast<std::uint64_t>(width) * height * constants.size();
+      }
+
+      return images;
+    }
+
+    /**
+     * @brief computeIterations computes escape iterations of a region of
+     * the current config on the render pool (no colourization), e.g. for
+     * render farm workers
+     * @param first_column - left edge of region
+     * @param first_row - top edge of region
+     * @param columns - region width
+     * @param rows - region height
+     * @param iterations - destination, row y of region at iterations + y * stride
+     * @param stride - distance between destination rows in elements
+     * @return number of iterations executed
+     */
+    std::uint64_t computeIterations(unsigned int first_column, unsigned int first_row,
+                                    unsigned int columns, unsigned int rows,
+                                    unsigned int *iterations, std::size_t stride) {
+      return computeIterations(cfg_, first_column, first_row, columns, rows, iterations, stride);
+    }
+
+    /**
+     * @brief computeIterations as above, for given config instead of the
+     * current one (GUI may change generator while a worker renders)
+     */
+    std::uint64_t computeIterations(const JuliaSetGeneratorConfig& cfg,
+                                    unsigned int first_column, unsigned int first_row,
+                                    unsigned int columns, unsigned int rows,
+                                    unsigned int *iterations, std::size_t stride) {
+      const JuliaSetGeneratorConfig local_cfg = cfg;
+      const Kernel kernel = resolveKernel(kernel_, local_cfg);
+      const InteriorTrap trap = interiorTrap(kernel, local_cfg);
+      std::atomic<std::uint64_t> executed(0);
+
+      pool_->parallelFor(rows, [&](std::size_t y) {
+        executed += computeRowIterations(first_row + static_cast<unsigned int>(y), first_column, columns,
+                                         iterations + y * stride, kernel, trap, local_cfg);
+      });
+
+      return executed;
+    }
+
+    /**
+     * @brief computeFrameIterations computes escape iterations of the
+     * whole frame of cfg, as computeIterations().
+     *
+     * When resumable, a frame differing from the previous one only by
+     * higher max iterations starts from its iterations: escaped pixels
+     * cannot change, capped pixels continue from their final z, so only
+     * the additional iterations are executed. Results are identical to
+     * a full computation.
+     *
+     * @param iterations - destination, width * height, row-major
+     * @return number of iterations executed
+     */
+    std::uint64_t computeFrameIterations(const JuliaSetGeneratorConfig& cfg, unsigned int *iterations) {
+      const JuliaSetGeneratorConfig local_cfg = cfg;
+
+      if (!resumable_ || (resolveKernel(kernel_, local_cfg) != Kernel::Double)) {
+        resume_ = ResumeState();
+        return computeIterations(local_cfg, 0, 0, local_cfg.width_, local_cfg.height_, iterations, local_cfg.width_);
+      }
+
+      RenderTraceScope trace("frame iterations", "kernel");
+      const InteriorTrap trap = interiorTrap(Kernel::Double, local_cfg);
+      const std::uint64_t executed = resumes(local_cfg) ? resumeFrameIterations(trap, local_cfg)
+                                                        : startFrameIterations(trap, local_cfg);
+
+      std::copy(resume_.iterations.begin(), resume_.iterations.end(), iterations);
+
+      return executed;
+    }
+
+    /**
+     * @brief colorizeIterations colourizes iterations of the whole frame
+     * of current config (computeIterations() results) with current colouring
+     * @param iterations - width * height iterations, row-major
+     * @param out - destination image of frame size (bitmap_image or MappedBitmapImage)
+     */
+    template <typename Image>
+    void colorizeIterations(const unsigned int *iterations, Image& out) {
+      colorizeIterations(cfg_, iterations, out);
+    }
+
+    /**
+     * @brief colorizeIterations as above, for given config instead of the
+     * current one
+     */
+    template <typename Image>
+    void colorizeIterations(const JuliaSetGeneratorConfig& cfg, const unsigned int *iterations, Image& out) {
+      const JuliaSetGeneratorConfig local_cfg = cfg;
+      const unsigned int width = local_cfg.width_;
+      Palette palette;
+
+      if (coloring_ == Coloring::HistogramEqualized) {
+        // Same pixels as framePalette() counts, so the palette matches renders
+        const unsigned int shift = histogramShift(local_cfg);
+        const unsigned int stride = paletteStride(local_cfg);
+        std::vector<std::vector<std::uint64_t> > histograms(pool_->threadCount(),
+                                                            std::vector<std::uint64_t>((local_cfg.max_iterations_ >> shift) + 1));
+
+        pool_->parallelFor((local_cfg.height_ + stride - 1) / stride, [&](std::size_t row) {
+          countIterations(iterations + row * stride * width, width, stride, shift,
+                          histograms[RenderPool::currentThreadIndex()]);
+        });
+
+        palette = reducePalette(histograms, shift);
+      } else {
+        palette = linearPalette(local_cfg);
+      }
+
+      pool_->parallelFor(local_cfg.height_, [&](std::size_t y) {
+        colorizeRow(iterations + y * width, width, out.row(static_cast<unsigned int>(y)), palette, local_cfg);
+      });
+    }
+
+    /**
+     * @brief generateToFile renders image strip by strip straight into BMP file.
+     *
+     * Only two strips are kept in memory: one being rendered on the pool
+     * while the previous one is written, so it works for images far
+     * larger than RAM (and above 4 GB).
+     *
+     * @param file_name - output BMP file
+     * @param strip_rows - rows rendered at once
+     * @return false on write error
+     */
+    bool generateToFile(const std::string& file_name, unsigned int strip_rows = 64) {
+      JuliaSetGeneratorConfig local_cfg = cfg_;
+
+      if (strip_rows == 0) strip_rows = 1;
+
+      BmpStripWriter writer(file_name, local_cfg.width_, local_cfg.height_);
+
+      if (!writer.good()) return false;
+
+      std::unique_ptr<bitmap_image> strips[2];
+      std::future<bool> pending_write;
+      unsigned int current = 0;
+
+      for (unsigned int y = 0; y < local_cfg.height_; y += strip_rows, current ^= 1) {
+        const unsigned int rows = std::min(strip_rows, local_cfg.height_ - y);
+
+        if (!strips[current] || (strips[current]->height() != rows)) {
+          strips[current] = std::make_unique<bitmap_image>(local_cfg.width_, rows);
+        }
+
+        renderRows(y, *strips[current], local_cfg);
+
+        // Writing previous strip overlaps with rendering of this one
+        if (pending_write.valid() && !pending_write.get()) return false;
+
+        const bitmap_image& strip = *strips[current];
+        pending_write = std::async(std::launch::async, [&writer, &strip, y] {
+          return writer.writeStrip(strip, y);
+        });
+      }
+
+      if (pending_write.valid() && !pending_write.get()) return false;
+
+      return writer.close();
+    }
+
+    /**
+     * @brief generateToMappedFile renders image directly into memory-mapped
+     * BMP file. Pixels go straight to the page cache, written back by the OS
+     * while rendering continues - no separate save pass, no in-memory image.
+     * @param file_name - output BMP file
+     * @return false if file could not be created or mapped
+     */
+    bool generateToMappedFile(const std::string& file_name) {
+      JuliaSetGeneratorConfig local_cfg = cfg_;
+
+      MappedBitmapImage image(file_name, local_cfg.width_, local_cfg.height_);
+
+      if (!image) return false;
+
+      renderRows(0, image, local_cfg);
+      image.flush();
+
+      return true;
+    }
+
+    /**
+     * @brief iterationsToColor maps escape iterations to colormap colour,
+     * interior (UINT_MAX) is black
+     * @param iterations
+     * @param cfg
+     * @return
+     */
+    static rgb_t iterationsToColor(unsigned int iterations, const JuliaSetGeneratorConfig& cfg) {
+      if (iterations != std::numeric_limits<unsigned int>::max()) {
+        unsigned int color_index = static_cast<unsigned int>((1000.0 * iterations) / cfg.max_iterations_);
+
+        // jet_colormap has 1000 entries, linearPalette() maps max iterations as well
+        if (color_index > 999) color_index = 999;
+
+        return jet_colormap[color_index];
+      }
+
+      return { 0, 0, 0 };
+    }
+
+    /**
+     * @brief computeCoordinateIterations escape-time kernel
+     * @param coord_real
+     * @param coord_imag
+     * @param cfg
+     * @return iteration at which |z| >= 2, UINT_MAX if it never escaped
+     */
+    static unsigned int computeCoordinateIterations(double coord_real, double coord_imag, const JuliaSetGeneratorConfig& cfg) {
+      double z_real = coord_real,
+             z_imag = coord_imag;
+      unsigned int i = 0;
+
+      return resumeCoordinateIterations(z_real, z_imag, i, InteriorTrap(), cfg);
+    }
+
+    /**
+     * @brief resumeCoordinateIterations double escape-time kernel starting
+     * at iteration i, computeCoordinateIterations() of a capped pixel
+     * continued to higher max iterations gives the same result
+     * @param z_real - z at iteration i, final z on return if it never escaped
+     * @param z_imag - as z_real
+     * @param i - iterations already done, on return iterations done
+     * @param trap - orbits entering it are interior (period 0: no trap)
+     * @return iteration at which |z| >= 2, UINT_MAX if it never escaped
+     */
+    static unsigned int resumeCoordinateIterations(double& z_real, double& z_imag, unsigned int& i,
+                                                   const InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+      return trap.period ? iterateCoordinate<true>(z_real, z_imag, i, trap, cfg)
+                         : iterateCoordinate<false>(z_real, z_imag, i, trap, cfg);
+    }
+
+    /**
+     * @brief iterateCoordinate loop of resumeCoordinateIterations(), trap
+     * test compiled in only when Trapped
+     */
+    template <bool Trapped>
+    static unsigned int iterateCoordinate(double& z_real, double& z_imag, unsigned int& i,
+                                          const InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+      // Equation:
+      // z_1 = z_0^2+c
+
+      const double c_real = cfg.c_realis_;
+      const double c_imag = cfg.c_imaginalis_;
+
+      // z_0 coordinates for first iteration
+      double z_0_imag = z_imag;
+      double z_0_real = z_real;
+
+      // Helper optimisation variables
+      double z_0_real_2, // squared z_0_real
+             z_0_imag_2; // squared z_0_imag
+
+      unsigned int max_i = cfg.max_iterations_;
+
+      // Iterate ....
+      for (; i < max_i; ++i) {
+        if (Trapped) {
+          const double trap_real = z_0_real - trap.real,
+                       trap_imag = z_0_imag - trap.imag;
+
+          // Converging to the attracting cycle, never escapes
+          if (trap_real * trap_real + trap_imag * trap_imag < trap.radius_2) break;
+        }
+
+        // Compute squared parts
+        z_0_real_2 = z_0_real * z_0_real;
+        z_0_imag_2 = z_0_imag * z_0_imag;
+
+        // compute z_1 values and store it in z_0 for next iteration.
+        //
+        // Normally it could take two steps:
+        // 1. compute z_1
+        // 2. shift z_1 to z_0
+        // This is optimized version. z_1 is only needed in next step as z_0.
+        z_0_imag = 2 * z_0_real * z_0_imag + c_imag;
+        z_0_real = z_0_real_2 - z_0_imag_2 + c_real;
+
+        // Stop condition |z_1| >= 2
+        if ( (z_0_real_2 + z_0_imag_2) >= 4.0) {
+          return i++;
+        }
+      }
+
+      z_real = z_0_real;
+      z_imag = z_0_imag;
+
+      return std::numeric_limits<unsigned int>::max();
+    }
+
+    /**
+     * @brief computeCoordinateIterations escape-time kernel for any real
+     * number type constructible from double with +, -, *, >=, sqr() and
+     * twice() (DoubleDouble, FixedPoint64, FixedPoint128)
+     * @return iteration at which |z| >= 2, UINT_MAX if it never escaped
+     */
+    template <typename Real>
+    static unsigned int computeCoordinateIterations(const Real& coord_real, const Real& coord_imag,
+                                                    const JuliaSetGeneratorConfig& cfg) {
+      const Real c_real(cfg.c_realis_),
+                 c_imag(cfg.c_imaginalis_),
+                 escape_radius_2(4.0);
+      Real z_real = coord_real,
+           z_imag = coord_imag;
+
+      for (unsigned int i = 0; i < cfg.max_iterations_; ++i) {
+        const Real z_real_2 = sqr(z_real);
+        const Real z_imag_2 = sqr(z_imag);
+
+        z_imag = twice(z_real * z_imag) + c_imag;
+        z_real = z_real_2 - z_imag_2 + c_real;
+
+        if ((z_real_2 + z_imag_2) >= escape_radius_2) return i;
+      }
+
+      return std::numeric_limits<unsigned int>::max();
+    }
+
+    /**
+     * @brief computeLaneIterations double escape-time kernel of a run of
+     * pixels of one row, BATCH_LANES pixels iterated side by side with the
+     * same operations as resumeCoordinateIterations(), so results are the
+     * same. Lane arithmetic has no per-lane branches; when a lane's pixel
+     * escapes, reaches max iterations or enters trap its result is stored
+     * and the lane is refilled with the next pixel, no lane idles while
+     * pixels are left.
+     * @param coord_real - real coordinates of the pixels
+     * @param coord_imag - imaginalis coordinate of the row
+     * @param columns - number of pixels
+     * @param iterations - destination, as computeCoordinateIterations()
+     * @param trap - interiorTrap() of cfg (period 0: no trap)
+     * @return number of iterations executed
+     */
+    static std::uint64_t computeLaneIterations(const double *coord_real, double coord_imag, unsigned int columns,
+                                               unsigned int *iterations, const InteriorTrap& trap,
+                                               const JuliaSetGeneratorConfig& cfg) {
+      return trap.period ? iterateLanes<true>(coord_real, coord_imag, columns, iterations, trap, cfg)
+                         : iterateLanes<false>(coord_real, coord_imag, columns, iterations, trap, cfg);
+    }
+
+    /**
+     * @brief iterateLanes loop of computeLaneIterations(), trap test
+     * compiled in only when Trapped
+     */
+    template <bool Trapped>
+    static std::uint64_t iterateLanes(const double *coord_real, double coord_imag, unsigned int columns,
+                                      unsigned int *iterations, const InteriorTrap& trap,
+                                      const JuliaSetGeneratorConfig& cfg) {
+      const double c_real = cfg.c_realis_;
+      const double c_imag = cfg.c_imaginalis_;
+      const std::uint64_t max_i = cfg.max_iterations_;
+      double z_real[BATCH_LANES],
+             z_imag[BATCH_LANES];
+      // Steps are counted once for all lanes, a lane's pixel has done
+      // step - first[l] iterations and is capped at step first[l] + max_i
+      std::uint64_t first[BATCH_LANES],
+                    step = 0,
+                    deadline = std::numeric_limits<std::uint64_t>::max();
+      unsigned int pixel[BATCH_LANES];
+      unsigned int active = 0,
+                   next = 0;
+      std::uint64_t executed = 0;
+
+      if (max_i == 0) {
+        std::fill(iterations, iterations + columns, std::numeric_limits<unsigned int>::max());
+        return 0;
+      }
+
+      auto start = [&](unsigned int l) {
+                     first[l] = step;
+
+                     if (next < columns) {
+                       pixel[l] = next++;
+                       z_real[l] = coord_real[pixel[l]];
+                       z_imag[l] = coord_imag;
+                       active |= 1U << l;
+                       deadline = std::min(deadline, step + max_i);
+                     } else {
+                       // Idle lane iterates a bounded orbit, its results are ignored
+                       z_real[l] = 0.0;
+                       z_imag[l] = 0.0;
+                       active &= ~(1U << l);
+                     }
+                   };
+
+      for (unsigned int l = 0; l < BATCH_LANES; ++l) start(l);
+
+      while (active) {
+        bool escaped[BATCH_LANES],
+             trapped[BATCH_LANES] = {};
+
+        for (unsigned int l = 0; l < BATCH_LANES; ++l) {
+          if (Trapped) {
+            const double trap_real = z_real[l] - trap.real,
+                         trap_imag = z_imag[l] - trap.imag;
+
+            trapped[l] = trap_real * trap_real + trap_imag * trap_imag < trap.radius_2;
+          }
+
+          const double z_real_2 = z_real[l] * z_real[l];
+          const double z_imag_2 = z_imag[l] * z_imag[l];
+
+          z_imag[l] = 2 * z_real[l] * z_imag[l] + c_imag;
+          z_real[l] = z_real_2 - z_imag_2 + c_real;
+
+          escaped[l] = (z_real_2 + z_imag_2) >= 4.0;
+        }
+
+        ++step;
+
+        bool any = (step == deadline);
+
+        for (unsigned int l = 0; l < BATCH_LANES; ++l) any |= escaped[l] | trapped[l];
+
+        if (!any) continue;
+
+        deadline = std::numeric_limits<std::uint64_t>::max();
+
+        for (unsigned int l = 0; l < BATCH_LANES; ++l) {
+          const std::uint64_t done = step - first[l];
+
+          if (!(active & (1U << l))) continue;
+
+          // Trap is tested before the step, escape after it, as in the scalar kernel
+          if (trapped[l]) {
+            iterations[pixel[l]] = std::numeric_limits<unsigned int>::max();
+            executed += done - 1;
+          } else if (escaped[l]) {
+            iterations[pixel[l]] = static_cast<unsigned int>(done - 1);
+            executed += done;
+          } else if (done == max_i) {
+            iterations[pixel[l]] = std::numeric_limits<unsigned int>::max();
+            executed += max_i;
+          } else {
+            deadline = std::min(deadline, first[l] + max_i);
+            continue;
+          }
+
+          start(l);
+        }
+      }
+
+      return executed;
+    }
+
+    /**
+     * @brief getComplexPlaneRealCoordinateDD as getComplexPlaneRealCoordinate,
+     * but pixel offset from view centre is kept below offset precision
+     */
+    static DoubleDouble getComplexPlaneRealCoordinateDD(double pixel_x, const JuliaSetGeneratorConfig& cfg) {
+      return DoubleDouble::twoSum((cfg.w2h_) * 2.0 * ((2.0 * pixel_x) / cfg.width_ - 1.0) * cfg.zoom_, cfg.off_x_);
+    }
+
+    /**
+     * @brief getComplexPlaneImaginalisCoordinateDD as getComplexPlaneImaginalisCoordinate,
+     * but pixel offset from view centre is kept below offset precision
+     */
+    static DoubleDouble getComplexPlaneImaginalisCoordinateDD(double pixel_y, const JuliaSetGeneratorConfig& cfg) {
+      return DoubleDouble::twoSum(2.0 * ((2.0 * pixel_y) / cfg.height_ - 1.0) * cfg.zoom_, -cfg.off_y_);
+    }
+
+    /**
+     * @brief getComplexPlaneRealCoordinate maps pixel x coord. on drawing
+     * to real part coordinate on complex plane
+     * @param pixel_x
+     * @param cfg generator config
+     * @return real part of coordinate in complex plane
+     */
+    inline static double getComplexPlaneRealCoordinate(double                         pixel_x,
+                                                       const JuliaSetGeneratorConfig& cfg) {
+      return (cfg.w2h_) * 2.0 * ((2.0 * pixel_x) / cfg.width_ - 1.0) * cfg.zoom_ + cfg.off_x_;
+    }
+
+    /**
+     * @brief getComplexPlaneImaginalisCoordinate  maps pixel Y coord. on drawing
+     * to imaginalis part coordinate on complex plane
+     * @param pixel_y
+     * @param cfg generator config
+     * @return imaginalis part of coordinate in complex plane
+     */
+    inline static double getComplexPlaneImaginalisCoordinate(double                         pixel_y,
+                                                             const JuliaSetGeneratorConfig& cfg) {
+      return 2.0 * ((2.0 * pixel_y) / cfg.height_ - 1.0) * cfg.zoom_ - cfg.off_y_;
+    }
+
+  private:
+
+    /**
+     * @brief renderRows renders rows [first_row, first_row + out.height())
+     * into out
+     * @param first_row - image row rendered into out row 0
+     * @param out - destination image of full width (bitmap_image or MappedBitmapImage)
+     * @param cfg - generator config
+     * @param stats - optional, timings and counters are added to it
+     */
+    template <typename Image>
+    void renderRows(unsigned int first_row, Image& out, const JuliaSetGeneratorConfig& cfg,
+                    RenderStats *stats = nullptr) {
+      renderRegion(0, first_row, out, cfg, stats);
+    }
+
+    /**
+     * @brief renderRegion renders image region of out size starting at
+     * (first_column, first_row) into out.
+     *
+     * Region is processed in bands of rows. For every band iterations
+     * are computed first (one TILE_SIZE square tile per pool work item)
+     * and colourized in a second pass (one row per work item), so both
+     * stages can be timed separately.
+     *
+     * Pipelined (default), a row of tiles is published in a lock-free
+     * queue as soon as its last tile is computed, the worker then
+     * colourizes whatever tile rows are ready before taking the next
+     * kernel tile. Colourization overlaps computation of the remaining
+     * tiles while iterations are still in cache, and pixels are still
+     * written row by row (colourizing single tiles scatters writes over
+     * the image and is about twice as slow). Kernel time is then the time
+     * until the last tile is computed, colourization time the rest of the pass.
+     *
+     * Per-pixel cost is very uneven, with TileSchedule::LongestFirst the
+     * tiles are handed out most expensive first, so no single slow tile
+     * is left running alone at the end of the pass. Cost comes from the
+     * previous frame when only the view moved (same region, c and max
+     * iterations), from a sparse sampling pre-pass otherwise.
+     *
+     * With Coloring::HistogramEqualized the cumulative palette comes from
+     * a histogram of a sparse pixel grid of the full frame, counted in a
+     * pre-pass (framePalette()) and cached for following parts, so strips,
+     * tiles and whole frame renders of one image match and stay band by
+     * band like linear colouring.
+     *
+     * Band iterations are stored in the narrowest IterationCell type that
+     * holds max iterations (iterationBytes()), so below 32768 iterations
+     * band buffers and the colourization pass read half or a quarter of
+     * the memory.
+     *
+     * @param first_column - image column rendered into out column 0
+     * @param first_row - image row rendered into out row 0
+     * @param out - destination image (bitmap_image or MappedBitmapImage)
+     * @param cfg - generator config
+     * @param stats - optional, timings and counters are added to it
+     * @param profile - optional, reset() to out size, per-pixel iterations
+     * and per-tile timings are stored in it
+     * @param capture - optional, receives iterations of the region (out
+     * width * height, row-major). A captured whole frame of the resumable
+     * double kernel is also kept with final z of its capped pixels, as
+     * computeFrameIterations() keeps it.
+     */
+    template <typename Image>
+    void renderRegion(unsigned int first_column, unsigned int first_row, Image& out,
+                      const JuliaSetGeneratorConfig& cfg, RenderStats *stats = nullptr,
+                      RenderProfile *profile = nullptr, unsigned int *capture = nullptr) {
+      switch (iterationBytes(cfg)) {
+        case 1:
+          renderRegion<std::uint8_t>(first_column, first_row, out, cfg, stats, profile, capture);
+          break;
+
+        case 2:
+          renderRegion<std::uint16_t>(first_column, first_row, out, cfg, stats, profile, capture);
+          break;
+
+        default:
+          renderRegion<unsigned int>(first_column, first_row, out, cfg, stats, profile, capture);
+      }
+    }
+
+    /**
+     * @brief renderRegion as above, band iterations stored as Iteration
+     */
+    template <typename Iteration, typename Image>
+    void renderRegion(unsigned int first_column, unsigned int first_row, Image& out,
+                      const JuliaSetGeneratorConfig& cfg, RenderStats *stats, RenderProfile *profile,
+                      unsigned int *capture) {
+      using clock = std::chrono::steady_clock;
+
+      const unsigned int width = out.width();
+      const unsigned int height = out.height();
+
+      if ((width == 0) || (height == 0)) return;
+
+      const Kernel kernel = resolveKernel(kernel_, cfg);
+      const InteriorTrap trap = interiorTrap(kernel, cfg);
+      const bool equalize = (coloring_ == Coloring::HistogramEqualized);
+      const bool whole_frame = (first_column == 0) && (first_row == 0) &&
+                               (width == cfg.width_) && (height == cfg.height_);
+      const bool keep_resume = capture && whole_frame && resumable_ && (kernel == Kernel::Double);
+
+      // Keep iteration buffer at MAX_BAND_PIXELS cells (16 MB of 32-bit
+      // cells) regardless of region height. Bands hold whole tile rows so
+      // tile grid is the same for every band, regions wider than
+      // MAX_BAND_PIXELS / TILE_SIZE get one tile row of width * TILE_SIZE.
+      const unsigned int band_rows = std::min(height, std::max(1U, MAX_BAND_PIXELS / width / TILE_SIZE) * TILE_SIZE);
+      const unsigned int tile_columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+
+      const std::size_t tile_count = static_cast<std::size_t>(tile_columns) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+
+      std::vector<Iteration> iterations(static_cast<std::size_t>(width) * band_rows);
+      std::vector<std::uint64_t> estimated_cost,
+                                 measured_cost(tile_count);
+      std::vector<std::size_t> order;
+      std::vector<std::vector<ResumeState::Capped> > tile_capped(keep_resume ? tile_count : 0);
+      std::atomic<std::uint64_t> total_iterations(0);
+      std::int64_t kernel_ns = 0,
+                   colorize_ns = 0;
+
+      RenderTrace& trace = RenderTrace::global();
+
+      const Palette palette = equalize ? framePalette(kernel, trap, cfg) : linearPalette(cfg);
+
+      if (schedule_ == TileSchedule::LongestFirst) {
+        const TileCosts& previous = tile_costs_;
+
+        if ((previous.cost.size() == tile_count) && (previous.first_column == first_column) &&
+            (previous.first_row == first_row) && (previous.width == width) && (previous.height == height) &&
+            (previous.cfg.c_realis_ == cfg.c_realis_) && (previous.cfg.c_imaginalis_ == cfg.c_imaginalis_) &&
+            (previous.cfg.max_iterations_ == cfg.max_iterations_)) {
+          estimated_cost = previous.cost;
+        } else {
+          estimated_cost = estimateTileCosts(first_column, first_row, width, height, kernel, trap, cfg);
+        }
+      }
+
+      for (unsigned int band = 0; band < height; band += band_rows) {
+        const unsigned int rows = std::min(band_rows, height - band);
+        const unsigned int tile_rows = (rows + TILE_SIZE - 1) / TILE_SIZE;
+        const std::size_t first_tile = static_cast<std::size_t>(band / TILE_SIZE) * tile_columns;
+        const bool tracing = trace.enabled();
+
+        order.resize(static_cast<std::size_t>(tile_columns) * tile_rows);
+        std::iota(order.begin(), order.end(), 0);
+
+        if (!estimated_cost.empty()) {
+          std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return estimated_cost[first_tile + a] > estimated_cost[first_tile + b];
+          });
+        }
+
+        auto colorizeTileRow = [&](std::size_t tile_row) {
+                                 const unsigned int y0 = static_cast<unsigned int>(tile_row) * TILE_SIZE;
+
+                                 RenderTraceScope tile_row_trace("colorize tile row", "colorize", "row", band + y0);
+
+                                 for (unsigned int y = y0; y < std::min(rows, y0 + TILE_SIZE); ++y) {
+                                   colorizeRow(&iterations[static_cast<std::size_t>(y) * width], width,
+                                               out.row(band + y), palette, cfg);
+                                 }
+                               };
+
+        // Tile row is published when its last tile is computed
+        BoundedQueue<std::size_t> ready(pipelined_ ? tile_rows : 1);
+        std::unique_ptr<std::atomic<unsigned int>[]> tiles_left(new std::atomic<unsigned int>[tile_rows]);
+        std::atomic<std::size_t> kernel_tiles_left(order.size());
+        std::atomic<std::int64_t> kernel_end_ns(0);
+
+        for (unsigned int r = 0; r < tile_rows; ++r) tiles_left[r].store(tile_columns);
+
+        const auto kernel_start = clock::now();
+        pool_->parallelFor(order.size(), [&](std::size_t i) {
+          const std::size_t t = order[i];
+          const unsigned int x0 = static_cast<unsigned int>(t % tile_columns) * TILE_SIZE;
+          const unsigned int y0 = static_cast<unsigned int>(t / tile_columns) * TILE_SIZE;
+          const unsigned int tile_width = std::min(TILE_SIZE, width - x0);
+          const unsigned int tile_height = std::min(TILE_SIZE, rows - y0);
+          const auto tile_start = clock::now();
+          std::uint64_t executed = 0;
+
+          const std::size_t tile = first_tile + t;
+
+          for (unsigned int y = y0; y < y0 + tile_height; ++y) {
+            Iteration *row = &iterations[static_cast<std::size_t>(y) * width + x0];
+
+            executed += keep_resume
+                        ? computeDoubleRowIterations(band + y, x0, tile_width, row, trap, cfg, &tile_capped[tile])
+                        : computeRowIterations(first_row + band + y, first_column + x0, tile_width, row, kernel, trap, cfg);
+          }
+
+          total_iterations += executed;
+          measured_cost[tile] = executed;
+
+          if (profile || tracing) {
+            const auto tile_end = clock::now();
+
+            if (tracing) {
+              trace.complete("tile", "kernel",
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(tile_start.time_since_epoch()).count(),
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(tile_end.time_since_epoch()).count(),
+                             "tile", static_cast<std::int64_t>(tile));
+            }
+
+            if (profile) {
+              const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tile_end - tile_start).count();
+              const unsigned int thread = RenderPool::currentThreadIndex();
+
+              profile->tile_ns[tile] = ns;
+              profile->tile_thread[tile] = thread;
+              // Every thread only touches its own slot
+              profile->thread_busy_ns[thread] += ns;
+            }
+          }
+
+          if (!pipelined_) return;
+
+          if (--tiles_left[t / tile_columns] == 0) ready.push(t / tile_columns);
+
+          if (--kernel_tiles_left == 0) {
+            kernel_end_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - kernel_start).count();
+          }
+
+          // Every producer drains after its push, so no tile row is left behind
+          std::size_t ready_row;
+
+          while (ready.pop(ready_row)) colorizeTileRow(ready_row);
+        });
+
+        if (profile) {
+          std::transform(iterations.begin(), iterations.begin() + static_cast<std::size_t>(width) * rows,
+                         profile->iterations.begin() + static_cast<std::size_t>(band) * width,
+                         IterationCell<Iteration>::unpack);
+        }
+
+        if (capture) {
+          std::transform(iterations.begin(), iterations.begin() + static_cast<std::size_t>(width) * rows,
+                         capture + static_cast<std::size_t>(band) * width, IterationCell<Iteration>::unpack);
+        }
+
+        const auto colorize_start = pipelined_ ? kernel_start + std::chrono::nanoseconds(kernel_end_ns.load())
+                                              : clock::now();
+
+        if (!pipelined_) {
+          pool_->parallelFor(rows, [&](std::size_t i) {
+            RenderTraceScope row_trace("colorize row", "colorize", "row", band + static_cast<std::int64_t>(i));
+
+            colorizeRow(&iterations[i * width], width, out.row(band + static_cast<unsigned int>(i)), palette, cfg);
+          });
+        }
+
+        const auto colorize_end = clock::now();
+
+        if (tracing) {
+          auto ns = [](clock::time_point t) {
+                      return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+                    };
+
+          trace.complete("kernel pass", "kernel", ns(kernel_start), ns(colorize_start), "band", band);
+          trace.complete("colorize pass", "colorize", ns(colorize_start), ns(colorize_end), "band", band);
+        }
+
+        kernel_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(colorize_start - kernel_start).count();
+        colorize_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(colorize_end - colorize_start).count();
+      }
+
+      if (keep_resume) {
+        resume_.cfg = cfg;
+        resume_.iterations.assign(capture, capture + static_cast<std::size_t>(width) * height);
+        resume_.capped.clear();
+
+        for (const std::vector<ResumeState::Capped>& capped : tile_capped) {
+          resume_.capped.insert(resume_.capped.end(), capped.begin(), capped.end());
+        }
+      }
+
+      tile_costs_.first_column = first_column;
+      tile_costs_.first_row = first_row;
+      tile_costs_.width = width;
+      tile_costs_.height = height;
+      tile_costs_.cfg = cfg;
+      tile_costs_.cost = std::move(measured_cost);
+
+      if (stats) {
+        stats->kernel_ns += kernel_ns;
+        stats->colorize_ns += colorize_ns;
+        stats->iterations += total_iterations;
+        stats->pixels += static_cast<std::uint64_t>(width) * height;
+      }
+    }
+
+    /**
+     * @brief interiorTrap
+     * @param kernel - resolved kernel
+     * @return interiorTrap() of cfg when the double kernel renders it
+     * with cycle detection on, no trap otherwise
+     */
+    InteriorTrap interiorTrap(Kernel kernel, const JuliaSetGeneratorConfig& cfg) const {
+      if (!cycle_detection_ || (kernel != Kernel::Double)) return InteriorTrap();
+
+      RenderTraceScope trace("cycle pre-pass", "kernel");
+
+      return interiorTrap(cfg);
+    }
+
+    /**
+     * @brief resumes
+     * @return true when computeFrameIterations() of cfg continues the
+     * kept frame: resumable double kernel, same view, no lower max iterations
+     */
+    bool resumes(const JuliaSetGeneratorConfig& cfg) const {
+      const JuliaSetGeneratorConfig& previous = resume_.cfg;
+
+      return resumable_ && (resolveKernel(kernel_, cfg) == Kernel::Double) &&
+             (resume_.iterations.size() == static_cast<std::size_t>(cfg.width_) * cfg.height_) &&
+             (previous.width_ == cfg.width_) && (previous.height_ == cfg.height_) &&
+             (previous.max_iterations_ <= cfg.max_iterations_) &&
+             (previous.c_realis_ == cfg.c_realis_) && (previous.c_imaginalis_ == cfg.c_imaginalis_) &&
+             (previous.zoom_ == cfg.zoom_) && (previous.off_x_ == cfg.off_x_) && (previous.off_y_ == cfg.off_y_);
+    }
+
+    /**
+     * @brief startFrameIterations computes iterations of the whole frame
+     * of cfg into resume_, keeping final z of capped pixels
+     * @return number of iterations executed
+     */
+    std::uint64_t startFrameIterations(const InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+      const unsigned int width = cfg.width_;
+      std::vector<std::vector<ResumeState::Capped> > capped_rows(cfg.height_);
+      std::atomic<std::uint64_t> executed(0);
+
+      resume_.cfg = cfg;
+      resume_.iterations.resize(static_cast<std::size_t>(width) * cfg.height_);
+
+      pool_->parallelFor(cfg.height_, [&](std::size_t y) {
+        executed += computeDoubleRowIterations(static_cast<unsigned int>(y), 0, width, &resume_.iterations[y * width],
+                                               trap, cfg, &capped_rows[y]);
+      });
+
+      resume_.capped.clear();
+
+      for (const std::vector<ResumeState::Capped>& row : capped_rows) {
+        resume_.capped.insert(resume_.capped.end(), row.begin(), row.end());
+      }
+
+      return executed;
+    }
+
+    /**
+     * @brief resumeFrameIterations continues capped pixels of resume_ up
+     * to max iterations of cfg, escaped ones are dropped from the state
+     * @return number of iterations executed
+     */
+    std::uint64_t resumeFrameIterations(const InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+      constexpr std::size_t CHUNK_PIXELS = 4096;
+
+      const unsigned int first = resume_.cfg.max_iterations_;
+      std::vector<ResumeState::Capped>& capped = resume_.capped;
+      std::atomic<std::uint64_t> executed(0);
+
+      if (first == cfg.max_iterations_) return 0;
+
+      pool_->parallelFor((capped.size() + CHUNK_PIXELS - 1) / CHUNK_PIXELS, [&](std::size_t chunk) {
+        const std::size_t end = std::min(capped.size(), (chunk + 1) * CHUNK_PIXELS);
+        std::uint64_t chunk_executed = 0;
+
+        for (std::size_t i = chunk * CHUNK_PIXELS; i < end; ++i) {
+          unsigned int done = first;
+
+          resume_.iterations[capped[i].pixel] = resumeCoordinateIterations(capped[i].z_real, capped[i].z_imag,
+                                                                           done, trap, cfg);
+          chunk_executed += done - first;
+        }
+
+        executed += chunk_executed;
+      });
+
+      capped.erase(std::remove_if(capped.begin(), capped.end(), [this](const ResumeState::Capped& pixel) {
+        return resume_.iterations[pixel.pixel] != std::numeric_limits<unsigned int>::max();
+      }), capped.end());
+      resume_.cfg = cfg;
+
+      return executed;
+    }
+
+    /**
+     * @brief estimateTileCosts sparse pre-pass, samples every tile on a
+     * 4x4 grid (1/256 of full tile work)
+     * @return estimated executed iterations per tile, row-major
+     */
+    std::vector<std::uint64_t> estimateTileCosts(unsigned int first_column, unsigned int first_row,
+                                                 unsigned int width, unsigned int height,
+                                                 Kernel kernel, const InteriorTrap& trap,
+                                                 const JuliaSetGeneratorConfig& cfg) {
+      constexpr unsigned int SAMPLES = 4;
+
+      RenderTraceScope trace("cost pre-pass", "kernel");
+      const unsigned int tile_columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+      std::vector<std::uint64_t> cost(static_cast<std::size_t>(tile_columns) * ((height + TILE_SIZE - 1) / TILE_SIZE));
+
+      pool_->parallelFor(cost.size(), [&](std::size_t t) {
+        const unsigned int x0 = static_cast<unsigned int>(t % tile_columns) * TILE_SIZE;
+        const unsigned int y0 = static_cast<unsigned int>(t / tile_columns) * TILE_SIZE;
+        const unsigned int tile_width = std::min(TILE_SIZE, width - x0);
+        const unsigned int tile_height = std::min(TILE_SIZE, height - y0);
+        std::uint64_t sampled = 0;
+
+        for (unsigned int sy = 0; sy < SAMPLES; ++sy) {
+          const unsigned int y = first_row + y0 + (2 * sy + 1) * tile_height / (2 * SAMPLES);
+
+          for (unsigned int sx = 0; sx < SAMPLES; ++sx) {
+            const unsigned int x = first_column + x0 + (2 * sx + 1) * tile_width / (2 * SAMPLES);
+            unsigned int it;
+
+            sampled += computeRowIterations(y, x, 1, &it, kernel, trap, cfg);
+          }
+        }
+
+        // Partial edge tiles cost proportionally less
+        cost[t] = sampled * tile_width * tile_height / (SAMPLES * SAMPLES);
+      });
+
+      return cost;
+    }
+
+    /**
+     * @brief computeRowIterations computes escape iterations of part of one image row
+     * @param y - image row
+     * @param first_column - first image column
+     * @param columns - number of pixels to compute
+     * @param iterations - destination, computeCoordinateIterations() results
+     * packed as IterationCell<Iteration>
+     * @param kernel - resolved kernel (not Auto)
+     * @param trap - interiorTrap() of cfg, used by the double kernel
+     * @param cfg - generator config
+     * @return number of iterations executed (for throughput statistics)
+     */
+    template <typename Iteration>
+    static std::uint64_t computeRowIterations(unsigned int y, unsigned int first_column, unsigned int columns,
+                                              Iteration *iterations, Kernel kernel, const InteriorTrap& trap,
+                                              const JuliaSetGeneratorConfig& cfg) {
+      switch (kernel) {
+        case Kernel::DoubleDouble:
+          return computeRowIterations(getComplexPlaneImaginalisCoordinateDD(y, cfg), first_column, columns,
+                                      iterations, cfg, [&cfg](unsigned int x) {
+            return getComplexPlaneRealCoordinateDD(x, cfg);
+          });
+
+        case Kernel::FixedPoint64:
+          return computeFixedRowIterations<FixedPoint64>(y, first_column, columns, iterations, cfg);
+
+        case Kernel::FixedPoint128:
+          return computeFixedRowIterations<FixedPoint128>(y, first_column, columns, iterations, cfg);
+
+        default:
+          return computeDoubleRowIterations(y, first_column, columns, iterations, trap, cfg);
+      }
+    }
+
+    /**
+     * @brief computeDoubleRowIterations double kernel row, pixels stop
+     * early when their orbit enters trap
+     * @param capped - optional, receives frame index and final z of pixels
+     * that did not escape (resume state)
+     * @return number of iterations executed
+     */
+    template <typename Iteration>
+    static std::uint64_t computeDoubleRowIterations(unsigned int y, unsigned int first_column, unsigned int columns,
+                                                    Iteration *iterations, const InteriorTrap& trap,
+                                                    const JuliaSetGeneratorConfig& cfg,
+                                                    std::vector<ResumeState::Capped> *capped = nullptr) {
+      // Compute imaginalis coordinate on complex plane
+      const double coord_imag = getComplexPlaneImaginalisCoordinate(y, cfg);
+      std::uint64_t executed = 0;
+
+      for (unsigned int x = 0; x < columns; ++x) {
+        double z_real = getComplexPlaneRealCoordinate(first_column + x, cfg),
+               z_imag = coord_imag;
+        unsigned int i = 0;
+
+        const unsigned int it = resumeCoordinateIterations(z_real, z_imag, i, trap, cfg);
+
+        iterations[x] = IterationCell<Iteration>::pack(it);
+        executed += i;
+
+        if (capped && (it == std::numeric_limits<unsigned int>::max())) {
+          capped->push_back({ static_cast<std::size_t>(y) * cfg.width_ + first_column + x, z_real, z_imag });
+        }
+      }
+
+      return executed;
+    }
+
+    /**
+     * @brief computeRowIterations row loop of one kernel
+     * @param coord_imag - imaginalis coordinate of row
+     * @param real_coordinate - image column to real coordinate mapping
+     * @return number of iterations executed
+     */
+    template <typename Real, typename Iteration, typename RealCoordinate>
+    static std::uint64_t computeRowIterations(const Real& coord_imag, unsigned int first_column, unsigned int columns,
+                                              Iteration *iterations, const JuliaSetGeneratorConfig& cfg,
+                                              const RealCoordinate& real_coordinate) {
+      std::uint64_t executed = 0;
+
+      for (unsigned int x = 0; x < columns; ++x) {
+        const unsigned int it = computeCoordinateIterations(real_coordinate(first_column + x), coord_imag, cfg);
+
+        iterations[x] = IterationCell<Iteration>::pack(it);
+        executed += (it == std::numeric_limits<unsigned int>::max()) ? cfg.max_iterations_ : it + 1ULL;
+      }
+
+      return executed;
+    }
+
+    /**
+     * @brief computeFixedRowIterations fixed-point kernel row. Coordinates
+     * are view centre plus an integer multiple of the pixel step, all in
+     * integer arithmetic, so the mapping is bit-exact too.
+     */
+    template <typename Fixed, typename Iteration>
+    static std::uint64_t computeFixedRowIterations(unsigned int y, unsigned int first_column, unsigned int columns,
+                                                   Iteration *iterations, const JuliaSetGeneratorConfig& cfg) {
+      // Half pixel step, pixel p is (2p - size) half steps from the centre
+      const Fixed half_step(2.0 * cfg.zoom_ / cfg.height_);
+      const Fixed off_x(cfg.off_x_);
+      const Fixed coord_imag = static_cast<std::int64_t>(2LL * y - cfg.height_) * half_step - Fixed(cfg.off_y_);
+
+      return computeRowIterations(coord_imag, first_column, columns, iterations, cfg, [&](unsigned int x) {
+        return static_cast<std::int64_t>(2LL * x - cfg.width_) * half_step + off_x;
+      });
+    }
+
+    /**
+     * @brief histogramShift
+     * @return right shift of escape iterations fitting them into MAX_HISTOGRAM_BINS
+     */
+    static unsigned int histogramShift(const JuliaSetGeneratorConfig& cfg) {
+      unsigned int shift = 0;
+
+      while ((cfg.max_iterations_ >> shift) >= MAX_HISTOGRAM_BINS) ++shift;
+
+      return shift;
+    }
+
+    /**
+     * @brief paletteStride distance between rows and columns of the pixel
+     * grid counted into equalized palettes (pixel 0, 0 is always counted)
+     * @return 1 for frames of up to 4 * PALETTE_SAMPLES pixels, up to
+     * MAX_PALETTE_STRIDE for larger ones
+     */
+    static unsigned int paletteStride(const JuliaSetGeneratorConfig& cfg) {
+      const double pixels = static_cast<double>(cfg.width_) * cfg.height_;
+      const unsigned int stride = static_cast<unsigned int>(std::sqrt(pixels / PALETTE_SAMPLES));
+
+      return std::min(MAX_PALETTE_STRIDE, std::max(1U, stride));
+    }
+
+    /**
+     * @brief countIterations adds escaped pixels of a row to histogram
+     * @param stride - only every stride-th pixel is counted
+     */
+    template <typename Iteration>
+    static void countIterations(const Iteration *iterations, unsigned int columns, unsigned int stride,
+                                unsigned int shift, std::vector<std::uint64_t>& histogram) {
+      for (unsigned int x = 0; x < columns; x += stride) {
+        if (!IterationCell<Iteration>::interior(iterations[x])) ++histogram[iterations[x] >> shift];
+      }
+    }
+
+    /**
+     * @brief reducePalette merges per-thread histograms (parallel over
+     * bin ranges) and turns cumulative pixel counts into colours
+     * @param histograms - per-thread histograms of equal size
+     * @param shift - histogram bin is iterations >> shift
+     */
+    Palette reducePalette(const std::vector<std::vector<std::uint64_t> >& histograms, unsigned int shift) {
+      constexpr std::size_t CHUNK_BINS = 4096;
+
+      RenderTraceScope trace("histogram reduce", "colorize");
+      const std::size_t bins = histograms.front().size();
+      std::vector<std::uint64_t> merged(bins);
+
+      pool_->parallelFor((bins + CHUNK_BINS - 1) / CHUNK_BINS, [&](std::size_t chunk) {
+        const std::size_t end = std::min(bins, (chunk + 1) * CHUNK_BINS);
+
+        for (const std::vector<std::uint64_t>& histogram : histograms) {
+          for (std::size_t b = chunk * CHUNK_BINS; b < end; ++b) merged[b] += histogram[b];
+        }
+      });
+
+      return cumulativePalette(merged, shift);
+    }
+
+    /**
+     * @brief cumulativePalette turns cumulative pixel counts of histogram
+     * into colours
+     * @param histogram - escaped pixels per bin
+     * @param shift - histogram bin is iterations >> shift
+     */
+    static Palette cumulativePalette(const std::vector<std::uint64_t>& histogram, unsigned int shift) {
+      Palette palette;
+      const std::uint64_t total = std::accumulate(histogram.begin(), histogram.end(), std::uint64_t(0));
+      std::uint64_t cumulative = 0;
+
+      palette.shift = shift;
+      palette.colors.resize(histogram.size());
+
+      for (std::size_t b = 0; b < histogram.size(); ++b) {
+        cumulative += histogram[b];
+        palette.colors[b] = jet_colormap[total ? (999 * cumulative) / total : 0];
+      }
+
+      return palette;
+    }
+
+    /**
+     * @brief linearPalette iterationsToColor() as lookup table
+     * @return palette, empty when max iterations do not fit MAX_HISTOGRAM_BINS
+     */
+    static Palette linearPalette(const JuliaSetGeneratorConfig& cfg) {
+      Palette palette;
+
+      if (cfg.max_iterations_ >= MAX_HISTOGRAM_BINS) return palette;
+
+      palette.colors.resize(cfg.max_iterations_ + 1);
+
+      for (unsigned int i = 0; i <= cfg.max_iterations_; ++i) palette.colors[i] = iterationsToColor(i, cfg);
+
+      return palette;
+    }
+
+    /**
+     * @brief framePalette equalized palette of the frame, cached for
+     * following parts of the frame. Only the paletteStride() grid is
+     * computed in the pre-pass (1/64 of the pixels of frames above one
+     * megapixel), one grid row at a time.
+     */
+    const Palette& framePalette(Kernel kernel, const InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+      const JuliaSetGeneratorConfig& cached = frame_palette_.cfg;
+
+      if (!frame_palette_.palette.colors.empty() && (frame_palette_.kernel == kernel) &&
+          (cached.width_ == cfg.width_) && (cached.height_ == cfg.height_) &&
+          (cached.max_iterations_ == cfg.max_iterations_) && (cached.c_realis_ == cfg.c_realis_) &&
+          (cached.c_imaginalis_ == cfg.c_imaginalis_) && (cached.zoom_ == cfg.zoom_) &&
+          (cached.off_x_ == cfg.off_x_) && (cached.off_y_ == cfg.off_y_)) {
+        return frame_palette_.palette;
+      }
+
+      RenderTraceScope trace("histogram pre-pass", "colorize");
+      const unsigned int shift = histogramShift(cfg);
+      std::vector<std::vector<std::uint64_t> > histograms(pool_->threadCount(),
+                                                          std::vector<std::uint64_t>((cfg.max_iterations_ >> shift) + 1));
+      std::vector<std::vector<unsigned int> > thread_samples(pool_->threadCount());
+      const unsigned int stride = paletteStride(cfg);
+
+      pool_->parallelFor((cfg.height_ + stride - 1) / stride, [&](std::size_t row) {
+        const std::size_t thread = RenderPool::currentThreadIndex();
+        std::vector<unsigned int>& samples = thread_samples[thread];
+
+        samples.resize((cfg.width_ + stride - 1) / stride);
+        computeSampleIterations(static_cast<unsigned int>(row * stride), stride, samples.data(), kernel, trap, cfg);
+        countIterations(samples.data(), static_cast<unsigned int>(samples.size()), 1, shift, histograms[thread]);
+      });
+
+      frame_palette_.cfg = cfg;
+      frame_palette_.kernel = kernel;
+      frame_palette_.palette = reducePalette(histograms, shift);
+
+      return frame_palette_.palette;
+    }
+
+    /**
+     * @brief computeSampleIterations computes escape iterations of every
+     * stride-th pixel of an image row (palette sampling grid)
+     * @param samples - destination, (width + stride - 1) / stride elements
+     */
+    static void computeSampleIterations(unsigned int y, unsigned int stride, unsigned int *samples, Kernel kernel,
+                                        const InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+      for (unsigned int x = 0; x < cfg.width_; x += stride) {
+        computeRowIterations(y, x, 1, samples++, kernel, trap, cfg);
+      }
+    }
+
+    /**
+     * @brief colorizeRow maps row of iterations to pixels
+     * @param iterations - computeCoordinateIterations() results, packed as
+     * IterationCell<Iteration>
+     * @param columns - number of pixels
+     * @param bgr - destination pixels in bitmap_image (BGR) layout
+     * @param cfg - generator config
+     */
+    template <typename Iteration>
+    static void colorizeRow(const Iteration *iterations, unsigned int columns,
+                            unsigned char *bgr, const JuliaSetGeneratorConfig& cfg) {
+      for (unsigned int x = 0; x < columns; ++x, bgr += 3) {
+        const rgb_t color = iterationsToColor(IterationCell<Iteration>::unpack(iterations[x]), cfg);
+
+        bgr[0] = color.blue;
+        bgr[1] = color.green;
+        bgr[2] = color.red;
+      }
+    }
+
+    /**
+     * @brief colorizeRow maps row of iterations to pixels through palette,
+     * iterationsToColor() when palette is empty
+     */
+    template <typename Iteration>
+    static void colorizeRow(const Iteration *iterations, unsigned int columns,
+                            unsigned char *bgr, const Palette& palette, const JuliaSetGeneratorConfig& cfg) {
+      if (palette.colors.empty()) colorizeRow(iterations, columns, bgr, cfg);
+      else colorizeRow(iterations, columns, bgr, palette);
+    }
+
+    /**
+     * @brief colorizeRow maps row of iterations to pixels through palette
+     * (one table lookup per pixel)
+     */
+    template <typename Iteration>
+    static void colorizeRow(const Iteration *iterations, unsigned int columns,
+                            unsigned char *bgr, const Palette& palette) {
+      const rgb_t *colors = palette.colors.data();
+
+      for (unsigned int x = 0; x < columns; ++x, bgr += 3) {
+        const rgb_t color = !IterationCell<Iteration>::interior(iterations[x])
+                            ? colors[iterations[x] >> palette.shift]
+                            : rgb_t { 0, 0, 0 };
+
+        bgr[0] = color.blue;
+        bgr[1] = color.green;
+        bgr[2] = color.red;
+      }
     }
 
     /**
@@ -4,11 +4,19 @@
 #include <QMainWindow>
 #include <QGraphicsScene>
 #include <QDoubleValidator>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <fractalgraphicsview.h>
 #include <julia_set_generator.h>
 #include <fractalworker.h>
+#include <render_stats.h>
+#include <render_trace.h>
+#include <flight_recorder.h>
+#include <frame_budget.h>
+#include <iteration_cache.h>
 
 Q_DECLARE_METATYPE(std::shared_ptr<bitmap_image>);
+Q_DECLARE_METATYPE(RenderStats);
 
 
 namespace Ui {
@@ -22,6 +30,33 @@ class MainWindow : public QMainWindow {
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    /**
+     * @brief requestRender starts rendering with current parameters,
+     * same as clicking "Generate". With a frame budget set, frame may be
+     * rendered at reduced quality, full quality follows once requests stop.
+     * @return false if a render is already running
+     */
+    bool requestRender();
+
+    /**
+     * @brief setIterationCache
+     * @param cache - cache of full quality frames, nullptr always renders
+     */
+    void setIterationCache(std::shared_ptr<IterationCache> cache) {
+      cache_ = std::move(cache);
+    }
+
+    /**
+     * @brief lastRenderStats
+     * @return stage timings and throughput counters of last displayed frame
+     */
+    const RenderStats& lastRenderStats() const {
+      return lastStats_;
+    }
+
+  signals:
+    void frameDisplayed(const RenderStats& stats);
+
   private slots:
     void on_checkBoxAutoGenerate_clicked(bool checked);
 
@@ -45,14 +80,65 @@ class MainWindow : public QMainWindow {
 
     void on_pushButtonFitToView_clicked();
 
+    void on_groupBoxStats_toggled(bool checked);
+
+    void on_comboBoxHeatmap_currentIndexChanged(int index);
+
+    void on_checkBoxTrace_toggled(bool checked);
+
+    void on_pushButtonSaveTrace_clicked();
+
+    void on_spinBoxSlowFrameMs_valueChanged(int arg1);
+
+    void on_spinBoxFrameBudgetMs_valueChanged(int arg1);
+
+    void on_checkBoxBudgetIterations_toggled(bool checked);
+
+    void on_comboBoxColoring_currentIndexChanged(int index);
+
+    void refineFrame();
+
   private:
+    /**
+     * @brief Idle time after last interactive frame request before the
+     * full quality frame is rendered
+     */
+    constexpr static const int REFINE_DELAY_MS = 250;
+
+    /**
+     * @brief Size limit of the iteration cache of full quality frames
+     */
+    constexpr static const std::uint64_t ITERATION_CACHE_BYTES = 512ULL << 20;
+
     Ui::MainWindow *ui;
 
     QImage image;
     QGraphicsScene *scene;
     JuliaSetGenerator generator;
+    /**
+     * @brief Generator rendering frames, used by the worker thread only
+     * (tile costs, palette and resume state of previous frames live in
+     * it). Settings of generator are copied into it when a frame is queued.
+     */
+    JuliaSetGenerator renderGenerator_;
     FractalWorker *generator_thread;
 
+    QElapsedTimer requestTimer_;
+    RenderStats lastStats_;
+    std::shared_ptr<const RenderProfile> lastProfile_;
+    FlightRecorder recorder_;
+    FrameBudgetController budget_;
+    std::shared_ptr<IterationCache> cache_;
+    JuliaSetGeneratorConfig frameFullConfig_; //!< full quality config of frame being rendered
+    QTimer refineTimer_;
+    bool renderPending_;
+
+    bool startRender(const JuliaSetGeneratorConfig& cfg);
+
+    void parametersChanged();
+
+    void updateStatsPanel(const RenderStats& stats, const RenderProfile *profile);
+
   private slots:
     void handleFractalResults(std::shared_ptr<bitmap_image> fractal);
 };
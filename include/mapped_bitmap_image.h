@@ -0,0 +1,202 @@
+#ifndef MAPPED_BITMAP_IMAGE_H
+#define MAPPED_BITMAP_IMAGE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+/**
+ * @brief The MappedBitmapImage class is a 24-bit image whose pixel
+ * storage is a memory-mapped file already laid out as a final BMP
+ * (headers, bottom-up rows, 4 byte row padding).
+ *
+ * Pixels written through row()/set_pixel() land directly in the page
+ * cache and the OS writes dirty pages back in the background, so there
+ * is no separate save pass and no in-memory copy of the image.
+ *
+ * Row and pixel access mirrors bitmap_image (top-down row index, BGR
+ * pixel order), so the generator can render into either of them.
+ *
+ * Only available on POSIX systems.
+ */
+class MappedBitmapImage {
+  public:
+    constexpr static const std::uint64_t HEADER_SIZE = 14 + 40;
+
+    /**
+     * @brief MappedBitmapImage creates file of final BMP size and maps it
+     * @param file_name - output BMP file
+     * @param width - image width in pixels
+     * @param height - image height in pixels
+     */
+    MappedBitmapImage(const std::string& file_name, unsigned int width, unsigned int height)
+      : width_(width), height_(height), data_(nullptr), size_(0) {
+      row_size_ = (3ULL * width_ + 3) & ~3ULL;
+
+      if ((width_ > static_cast<unsigned int>(std::numeric_limits<std::int32_t>::max())) ||
+          (height_ > static_cast<unsigned int>(std::numeric_limits<std::int32_t>::max()))) {
+        std::cerr << "MappedBitmapImage::MappedBitmapImage(): Error - Image size exceeds BMP limits!" << std::endl;
+        return;
+      }
+
+#ifndef _WIN32
+      const std::uint64_t size = HEADER_SIZE + row_size_ * height_;
+
+      int fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+      if (fd < 0) {
+        std::cerr << "MappedBitmapImage::MappedBitmapImage(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return;
+      }
+
+      if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "MappedBitmapImage::MappedBitmapImage(): Error - Could not resize file "
+                  << file_name << "!" << std::endl;
+        ::close(fd);
+        return;
+      }
+
+      void *map = ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+      // Mapping keeps its own reference to the file
+      ::close(fd);
+
+      if (map == MAP_FAILED) {
+        std::cerr << "MappedBitmapImage::MappedBitmapImage(): Error - Could not map file "
+                  << file_name << "!" << std::endl;
+        return;
+      }
+
+      data_ = static_cast<unsigned char *>(map);
+      size_ = static_cast<std::size_t>(size);
+
+      writeHeaders();
+#else
+      std::cerr << "MappedBitmapImage::MappedBitmapImage(): Error - Not supported on this platform!" << std::endl;
+      (void)file_name;
+#endif
+    }
+
+    MappedBitmapImage(const MappedBitmapImage&) = delete;
+    MappedBitmapImage& operator=(const MappedBitmapImage&) = delete;
+
+    ~MappedBitmapImage() {
+      close();
+    }
+
+    inline bool operator!() const {
+      return data_ == nullptr;
+    }
+
+    inline unsigned int width() const {
+      return width_;
+    }
+
+    inline unsigned int height() const {
+      return height_;
+    }
+
+    /**
+     * @brief row
+     * @param row_index - top-down row index, like bitmap_image::row()
+     * @return pointer to first BGR pixel of the row inside mapping
+     */
+    inline unsigned char * row(unsigned int row_index) const {
+      return data_ + HEADER_SIZE + row_size_ * (height_ - row_index - 1);
+    }
+
+    inline void set_pixel(const unsigned int x, const unsigned int y,
+                          const unsigned char red,
+                          const unsigned char green,
+                          const unsigned char blue) {
+      unsigned char *pixel = row(y) + 3 * static_cast<std::size_t>(x);
+
+      pixel[0] = blue;
+      pixel[1] = green;
+      pixel[2] = red;
+    }
+
+    template <typename RGB>
+    inline void set_pixel(const unsigned int x, const unsigned int y, const RGB& colour) {
+      set_pixel(x, y, colour.red, colour.green, colour.blue);
+    }
+
+    /**
+     * @brief flush schedules write-back of dirty pages without waiting
+     */
+    void flush() {
+#ifndef _WIN32
+
+      if (data_) ::msync(data_, size_, MS_ASYNC);
+
+#endif
+    }
+
+    /**
+     * @brief close unmaps the file, the OS finishes write-back on its own
+     */
+    void close() {
+#ifndef _WIN32
+
+      if (data_) ::munmap(data_, size_);
+
+#endif
+      data_ = nullptr;
+      size_ = 0;
+    }
+
+  private:
+    template <typename T>
+    unsigned char * writeLE(unsigned char *dst, T value) {
+      for (unsigned int i = 0; i < sizeof(T); ++i) {
+        *(dst++) = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+      }
+
+      return dst;
+    }
+
+    void writeHeaders() {
+      const std::uint64_t image_size = row_size_ * height_;
+      const std::uint64_t file_size = HEADER_SIZE + image_size;
+      const std::uint64_t max_field = std::numeric_limits<std::uint32_t>::max();
+
+      unsigned char *dst = data_;
+
+      // bitmap file header
+      dst = writeLE<std::uint16_t>(dst, 19778);
+      dst = writeLE<std::uint32_t>(dst, file_size > max_field ? 0 : static_cast<std::uint32_t>(file_size));
+      dst = writeLE<std::uint16_t>(dst, 0);
+      dst = writeLE<std::uint16_t>(dst, 0);
+      dst = writeLE<std::uint32_t>(dst, static_cast<std::uint32_t>(HEADER_SIZE));
+
+      // bitmap information header
+      dst = writeLE<std::uint32_t>(dst, 40);
+      dst = writeLE<std::uint32_t>(dst, width_);
+      dst = writeLE<std::uint32_t>(dst, height_);
+      dst = writeLE<std::uint16_t>(dst, 1);
+      dst = writeLE<std::uint16_t>(dst, 24);
+      dst = writeLE<std::uint32_t>(dst, 0);
+      dst = writeLE<std::uint32_t>(dst, image_size > max_field ? 0 : static_cast<std::uint32_t>(image_size));
+      dst = writeLE<std::uint32_t>(dst, 0);
+      dst = writeLE<std::uint32_t>(dst, 0);
+      dst = writeLE<std::uint32_t>(dst, 0);
+      writeLE<std::uint32_t>(dst, 0);
+    }
+
+    unsigned int width_,
+                 height_;
+    std::uint64_t row_size_;
+    unsigned char *data_;
+    std::size_t size_;
+};
+
+#endif // MAPPED_BITMAP_IMAGE_H
@@ -0,0 +1,517 @@
+#ifndef RENDER_DAEMON_H
+#define RENDER_DAEMON_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <julia_set_generator.h>
+#include <render_farm.h>
+#include <render_stats.h>
+
+#ifndef _WIN32
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+
+/**
+ * @brief The TileCache class keeps iterations of recently rendered tiles
+ * in memory, bounded by size with least recently used eviction.
+ *
+ * Keys are built by key() from every result-relevant config field (exact
+ * bits of doubles), resolved kernel and tile rectangle. Thread safe.
+ */
+class TileCache {
+  public:
+    /**
+     * @brief TileCache
+     * @param capacity - max bytes of cached iterations
+     */
+    explicit TileCache(std::size_t capacity) : capacity_(capacity), size_(0) {
+    }
+
+    static std::string key(const JuliaSetGeneratorConfig& cfg, const std::string& kernel,
+                           unsigned int x, unsigned int y, unsigned int columns, unsigned int rows) {
+      std::vector<unsigned char> key;
+
+      FarmChannel::putConfig(key, cfg, kernel);
+      FarmChannel::putU32(key, x);
+      FarmChannel::putU32(key, y);
+      FarmChannel::putU32(key, columns);
+      FarmChannel::putU32(key, rows);
+
+      return std::string(key.begin(), key.end());
+    }
+
+    /**
+     * @brief find
+     * @return copy of cached iterations, false if not cached
+     */
+    bool find(const std::string& key, std::vector<unsigned int>& iterations) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto entry = index_.find(key);
+
+      if (entry == index_.end()) return false;
+
+      entries_.splice(entries_.begin(), entries_, entry->second);
+      iterations = entry->second->second;
+
+      return true;
+    }
+
+    void insert(const std::string& key, const std::vector<unsigned int>& iterations) {
+      const std::size_t bytes = iterations.size() * sizeof(unsigned int);
+
+      if (bytes > capacity_) return;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (index_.count(key)) return;
+
+      entries_.emplace_front(key, iterations);
+      index_[key] = entries_.begin();
+      size_ += bytes;
+
+      while (size_ > capacity_) {
+        size_ -= entries_.back().second.size() * sizeof(unsigned int);
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+      }
+    }
+
+  private:
+    typedef std::list<std::pair<std::string, std::vector<unsigned int> > > Entries;
+
+    std::mutex mutex_;
+    Entries entries_;
+    std::unordered_map<std::string, Entries::iterator> index_;
+    std::size_t capacity_,
+                size_;
+};
+
+/**
+ * @brief The RenderDaemon class serves render requests of local clients
+ * (RenderDaemonClient) on a Unix domain socket.
+ *
+ * All clients share one render pool and one TileCache. A request for a
+ * frame that is already being rendered joins that job instead of
+ * starting another one. Tiles are streamed back (FarmChannel TileData,
+ * compressed iterations) as soon as they are done, followed by
+ * the colourized frame if the client asked for it, then Done.
+ */
+class RenderDaemon {
+  public:
+    constexpr static const unsigned int TILE_SIZE = 128;
+    constexpr static const std::uint32_t WANT_IMAGE = 1; //!< request flag: send colourized BMP
+    constexpr static const std::uint64_t MAX_PIXELS = 1ULL << 28;
+
+    /**
+     * @brief RenderDaemon
+     * @param pool - render pool shared by all clients
+     * @param cache_bytes - tile cache size
+     */
+    RenderDaemon(std::shared_ptr<RenderPool> pool, std::size_t cache_bytes)
+      : pool_(std::move(pool)), cache_(cache_bytes) {
+    }
+
+    /**
+     * @brief listen serves clients on a Unix domain socket (only the
+     * owner may connect), one thread per client, forever
+     * @param path - socket file, replaced if it is a stale socket
+     * @return false if socket could not be set up
+     */
+    bool listen(const std::string& path) {
+      sockaddr_un address;
+
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+
+      if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "RenderDaemon::listen(): Error - Socket path " << path << " too long!" << std::endl;
+        return false;
+      }
+
+      std::memcpy(address.sun_path, path.c_str(), path.size());
+
+      struct stat existing;
+
+      if (::lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+          std::cerr << "RenderDaemon::listen(): Error - " << path << " exists and is not a socket!" << std::endl;
+          return false;
+        }
+
+        ::unlink(path.c_str());
+      }
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+      // The socket file is created by bind(), so the mask makes it 0600 from the start
+      const mode_t mask = ::umask(077);
+      const bool bound = (fd >= 0) && (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+
+      ::umask(mask);
+
+      if (!bound || (::listen(fd, 16) != 0)) {
+        std::cerr << "RenderDaemon::listen(): Error - Could not listen on " << path << "!" << std::endl;
+
+        if (fd >= 0) ::close(fd);
+
+        return false;
+      }
+
+      for (;;) {
+        const int connection = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (connection < 0) continue;
+
+        std::thread(&RenderDaemon::serve, this, connection).detach();
+      }
+    }
+
+    /**
+     * @brief serve answers requests of one client until it disconnects
+     * @param fd - connected socket, closed on return
+     */
+    void serve(int fd) {
+      FarmChannel channel(fd);
+      FarmChannel::Type type;
+      std::vector<unsigned char> payload;
+
+      while (channel.receive(type, payload) && (type == FarmChannel::Type::Request)) {
+        FarmChannel::Reader reader(payload);
+        JuliaSetGeneratorConfig cfg;
+        JuliaSetGenerator::Kernel kernel;
+
+        FarmChannel::readConfig(reader, cfg, kernel);
+
+        const std::string coloring = reader.string();
+        const std::uint32_t flags = reader.u32();
+
+        if (!reader.ok() || (static_cast<std::uint64_t>(cfg.width_) * cfg.height_ > MAX_PIXELS) ||
+            ((coloring != "linear") && (coloring != "equalized"))) {
+          std::cerr << "RenderDaemon::serve(): Error - Invalid request!" << std::endl;
+          return;
+        }
+
+        JuliaSetGenerator gen;
+
+        gen.setRenderPool(pool_).setWidth(cfg.width_).setHeight(cfg.height_).setMaxIterations(cfg.max_iterations_).
+        setConstantRealis(cfg.c_realis_).setConstantImaginalis(cfg.c_imaginalis_).
+        setZoom(cfg.zoom_).setOffsetX(cfg.off_x_).setOffsetY(cfg.off_y_).setKernel(kernel).
+        setColoring(coloring == "equalized" ? JuliaSetGenerator::Coloring::HistogramEqualized
+                                            : JuliaSetGenerator::Coloring::Linear);
+
+        std::shared_ptr<Job> job;
+        bool owner = false;
+        const std::string key = TileCache::key(cfg, gen.kernelName(), 0, 0, 0, 0);
+        {
+          std::lock_guard<std::mutex> lock(jobs_mutex_);
+          std::weak_ptr<Job>& running = jobs_[key];
+
+          job = running.lock();
+
+          if (!job) {
+            job = std::make_shared<Job>(cfg);
+            running = job;
+            owner = true;
+          }
+        }
+
+        // Owner renders and streams in between tiles, others only stream
+        const bool streamed = owner ? runJob(*job, gen, channel) : streamJob(*job, channel, 0);
+
+        if (owner) {
+          std::lock_guard<std::mutex> lock(jobs_mutex_);
+          jobs_.erase(key);
+        }
+
+        if (!streamed) return;
+
+        if (flags & WANT_IMAGE) {
+          bitmap_image image(cfg.width_, cfg.height_);
+
+          gen.colorizeIterations(job->iterations.data(), image);
+
+          const std::unique_ptr<unsigned char[]> bmp = image.get_image();
+          // get_size() counts padded header structs, the file has packed ones
+          const std::size_t size = MappedBitmapImage::HEADER_SIZE + ((3ULL * cfg.width_ + 3) & ~3ULL) * cfg.height_;
+
+          if (!channel.send(FarmChannel::Type::Image, std::vector<unsigned char>(bmp.get(), bmp.get() + size))) return;
+        }
+
+        std::vector<unsigned char> done;
+
+        FarmChannel::putU64(done, job->executed);
+        FarmChannel::putU32(done, static_cast<std::uint32_t>(job->tiles.size()));
+        FarmChannel::putU32(done, job->cached);
+
+        if (!channel.send(FarmChannel::Type::Done, done)) return;
+      }
+    }
+
+  private:
+    struct Tile {
+      unsigned int x,
+                   y,
+                   columns,
+                   rows;
+    };
+
+    /**
+     * @brief The Job struct is one frame being rendered, shared by all
+     * clients that asked for it
+     */
+    struct Job {
+      explicit Job(const JuliaSetGeneratorConfig& frame_cfg)
+        : cfg(frame_cfg), iterations(static_cast<std::size_t>(frame_cfg.width_) * frame_cfg.height_),
+        executed(0), cached(0), finished(false) {
+        for (unsigned int y = 0; y < cfg.height_; y += TILE_SIZE) {
+          for (unsigned int x = 0; x < cfg.width_; x += TILE_SIZE) {
+            tiles.push_back({ x, y, std::min(TILE_SIZE, cfg.width_ - x), std::min(TILE_SIZE, cfg.height_ - y) });
+          }
+        }
+      }
+
+      const JuliaSetGeneratorConfig cfg;
+      std::vector<Tile> tiles;
+      std::vector<unsigned int> iterations;
+      std::vector<std::uint32_t> completed; //!< tile ids in completion order
+      std::uint64_t executed;
+      std::uint32_t cached;
+      bool finished;
+      std::mutex mutex;
+      std::condition_variable progress;
+    };
+
+    /**
+     * @brief runJob renders tiles of job (cache first), publishes each and
+     * streams it to the owner's client; keeps rendering for the other
+     * clients when the owner's one goes away
+     * @return false if owner's client is gone
+     */
+    bool runJob(Job& job, JuliaSetGenerator& gen, FarmChannel& channel) {
+      const std::string kernel = gen.kernelName();
+      std::vector<unsigned int> tile_iterations;
+      std::size_t sent = 0;
+      bool connected = true;
+
+      for (std::uint32_t id = 0; id < job.tiles.size(); ++id) {
+        const Tile& tile = job.tiles[id];
+        const std::string key = TileCache::key(job.cfg, kernel, tile.x, tile.y, tile.columns, tile.rows);
+        const bool hit = cache_.find(key, tile_iterations);
+        std::uint64_t executed = 0;
+
+        if (!hit) {
+          tile_iterations.resize(static_cast<std::size_t>(tile.columns) * tile.rows);
+          executed = gen.computeIterations(tile.x, tile.y, tile.columns, tile.rows, tile_iterations.data(), tile.columns);
+          cache_.insert(key, tile_iterations);
+        }
+
+        for (unsigned int y = 0; y < tile.rows; ++y) {
+          std::copy_n(tile_iterations.data() + static_cast<std::size_t>(y) * tile.columns, tile.columns,
+                      job.iterations.data() + static_cast<std::size_t>(tile.y + y) * job.cfg.width_ + tile.x);
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(job.mutex);
+          job.completed.push_back(id);
+          job.executed += executed;
+          job.cached += hit ? 1 : 0;
+          job.finished = (id + 1 == job.tiles.size());
+        }
+        job.progress.notify_all();
+
+        if (connected) {
+          connected = sendTiles(job, channel, sent, id + 1);
+          sent = id + 1;
+        }
+      }
+
+      return connected;
+    }
+
+    /**
+     * @brief streamJob sends tiles of job as they complete until it is
+     * finished
+     * @param sent - tiles already sent
+     * @return false if client is gone
+     */
+    bool streamJob(Job& job, FarmChannel& channel, std::size_t sent) {
+      for (;;) {
+        std::size_t available;
+        bool finished;
+        {
+          std::unique_lock<std::mutex> lock(job.mutex);
+          job.progress.wait(lock, [&job, sent] {
+            return job.finished || (job.completed.size() > sent);
+          });
+          available = job.completed.size();
+          finished = job.finished;
+        }
+
+        if (!sendTiles(job, channel, sent, available)) return false;
+
+        if (finished) return true;
+
+        sent = available;
+      }
+    }
+
+    /**
+     * @brief sendTiles sends completed tiles [first, last) of job
+     */
+    bool sendTiles(Job& job, FarmChannel& channel, std::size_t first, std::size_t last) {
+      std::vector<unsigned char> message;
+
+      for (std::size_t i = first; i < last; ++i) {
+        std::uint32_t id;
+        {
+          std::lock_guard<std::mutex> lock(job.mutex);
+          id = job.completed[i];
+        }
+
+        const Tile& tile = job.tiles[id];
+
+        message.clear();
+        FarmChannel::putU32(message, tile.x);
+        FarmChannel::putU32(message, tile.y);
+        FarmChannel::putU32(message, tile.columns);
+        FarmChannel::putU32(message, tile.rows);
+        IterationCodec::encodeTile(job.iterations.data() + static_cast<std::size_t>(tile.y) * job.cfg.width_ + tile.x,
+                                   tile.columns, tile.rows, job.cfg.width_, message);
+
+        if (!channel.send(FarmChannel::Type::TileData, message)) return false;
+      }
+
+      return true;
+    }
+
+    std::shared_ptr<RenderPool> pool_;
+    TileCache cache_;
+    std::mutex jobs_mutex_;
+    std::map<std::string, std::weak_ptr<Job> > jobs_;
+};
+
+/**
+ * @brief The RenderDaemonClient class requests frames from a RenderDaemon
+ */
+class RenderDaemonClient {
+  public:
+    /**
+     * @brief connect
+     * @param path - daemon socket file
+     * @return false if daemon is not reachable
+     */
+    bool connect(const std::string& path) {
+      sockaddr_un address;
+
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+
+      if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "RenderDaemonClient::connect(): Error - Socket path " << path << " too long!" << std::endl;
+        return false;
+      }
+
+      std::memcpy(address.sun_path, path.c_str(), path.size());
+
+      channel_.close();
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+      if ((fd < 0) || (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)) {
+        std::cerr << "RenderDaemonClient::connect(): Error - Could not connect to " << path << "!" << std::endl;
+
+        if (fd >= 0) ::close(fd);
+
+        return false;
+      }
+
+      channel_.open(fd);
+
+      return true;
+    }
+
+    /**
+     * @brief render requests a frame and receives its tiles as the daemon
+     * completes them
+     * @param cfg - frame config
+     * @param kernel - kernel name (JuliaSetGenerator::kernelName())
+     * @param coloring - "linear" or "equalized", used for bmp
+     * @param iterations - receives width * height iterations, row-major
+     * @param bmp - receives colourized frame as BMP file if not null
+     * @param stats - optional, iterations and pixels are added to it
+     * @param on_tile - called with x, y, width and height of every received tile
+     * @return false on connection or protocol error
+     */
+    bool render(const JuliaSetGeneratorConfig& cfg, const std::string& kernel, const std::string& coloring,
+                std::vector<unsigned int>& iterations, std::vector<unsigned char> *bmp = nullptr,
+                RenderStats *stats = nullptr,
+                const std::function<void(unsigned int, unsigned int, unsigned int, unsigned int)>& on_tile = nullptr) {
+      std::vector<unsigned char> payload;
+
+      FarmChannel::putConfig(payload, cfg, kernel);
+      FarmChannel::putString(payload, coloring);
+      FarmChannel::putU32(payload, bmp ? RenderDaemon::WANT_IMAGE : 0);
+
+      if (!channel_.send(FarmChannel::Type::Request, payload)) return false;
+
+      iterations.assign(static_cast<std::size_t>(cfg.width_) * cfg.height_, 0);
+
+      FarmChannel::Type type;
+
+      while (channel_.receive(type, payload)) {
+        FarmChannel::Reader reader(payload);
+
+        if (type == FarmChannel::Type::TileData) {
+          const unsigned int x = reader.u32(),
+                             y = reader.u32(),
+                             columns = reader.u32(),
+                             rows = reader.u32();
+
+          if (!reader.ok() || (x >= cfg.width_) || (columns > cfg.width_ - x) || (y >= cfg.height_) ||
+              (rows > cfg.height_ - y) ||
+              !IterationCodec::decodeTile(reader.position(), reader.end(),
+                                             iterations.data() + static_cast<std::size_t>(y) * cfg.width_ + x,
+                                             columns, rows, cfg.width_)) break;
+
+          if (on_tile) on_tile(x, y, columns, rows);
+        } else if ((type == FarmChannel::Type::Image) && bmp) {
+          bmp->swap(payload);
+        } else if (type == FarmChannel::Type::Done) {
+          const std::uint64_t executed = reader.u64();
+
+          if (stats) {
+            stats->iterations += executed;
+            stats->pixels += iterations.size();
+          }
+
+          return reader.ok();
+        } else {
+          break;
+        }
+      }
+
+      std::cerr << "RenderDaemonClient::render(): Error - Connection to daemon lost!" << std::endl;
+
+      return false;
+    }
+
+  private:
+    FarmChannel channel_;
+};
+
+#endif // _WIN32
+
+#endif // RENDER_DAEMON_H
@@ -0,0 +1,993 @@
+#ifndef RENDER_FARM_H
+#define RENDER_FARM_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <julia_set_generator.h>
+#include <iteration_codec.h>
+#include <render_stats.h>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <netdb.h>
+  #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <poll.h>
+  #include <signal.h>
+  #include <sys/mman.h>
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/time.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+
+/**
+ * @brief The FarmChannel class is one end of a render farm connection
+ * (socketpair to a local worker process or TCP to a remote one) or of a
+ * render daemon connection (Unix domain socket).
+ *
+ * Messages are framed as little-endian u32 type, u32 payload length and
+ * payload, fields inside payloads are little-endian as well, so workers
+ * on any host understand each other.
+ */
+class FarmChannel {
+  public:
+    enum class Type : std::uint32_t {
+      Config = 1, //!< frame config, kernel and shared memory name
+      Tile = 2,   //!< tile id, x, y, width, height
+      Result = 3, //!< tile id, executed iterations, encoded iterations (TCP only)
+      Request = 4,  //!< render daemon: frame config, kernel, colouring, flags
+      TileData = 5, //!< render daemon: x, y, width, height, encoded iterations
+      Image = 6,    //!< render daemon: colourized frame as BMP
+      Done = 7      //!< render daemon: executed iterations, tiles, cached tiles
+    };
+
+    constexpr static const std::uint32_t MAX_PAYLOAD = 1U << 30;
+
+    /**
+     * @brief The Reader class decodes payload fields, any read past the
+     * end clears ok() and returns zero
+     */
+    class Reader {
+      public:
+        explicit Reader(const std::vector<unsigned char>& payload)
+          : data_(payload.data()), end_(payload.data() + payload.size()), ok_(true) {
+        }
+
+        std::uint64_t u64() {
+          return read(8);
+        }
+
+        std::uint32_t u32() {
+          return static_cast<std::uint32_t>(read(4));
+        }
+
+        double f64() {
+          const std::uint64_t bits = read(8);
+          double value;
+
+          std::memcpy(&value, &bits, sizeof(value));
+
+          return value;
+        }
+
+        std::string string() {
+          const std::uint32_t length = u32();
+
+          if (!ok_ || (static_cast<std::size_t>(end_ - data_) < length)) {
+            ok_ = false;
+            return std::string();
+          }
+
+          std::string value(reinterpret_cast<const char *>(data_), length);
+          data_ += length;
+
+          return value;
+        }
+
+        const unsigned char *position() const {
+          return data_;
+        }
+
+        const unsigned char *end() const {
+          return end_;
+        }
+
+        bool ok() const {
+          return ok_;
+        }
+
+        void fail() {
+          ok_ = false;
+        }
+
+      private:
+        std::uint64_t read(unsigned int size) {
+          if (!ok_ || (static_cast<std::size_t>(end_ - data_) < size)) {
+            ok_ = false;
+            return 0;
+          }
+
+          std::uint64_t value = 0;
+
+          for (unsigned int i = 0; i < size; ++i) value |= static_cast<std::uint64_t>(*(data_++)) << (8 * i);
+
+          return value;
+        }
+
+        const unsigned char *data_,
+                            *end_;
+        bool ok_;
+    };
+
+    explicit FarmChannel(int fd = -1) : fd_(fd) {
+    }
+
+    FarmChannel(const FarmChannel&) = delete;
+    FarmChannel& operator=(const FarmChannel&) = delete;
+
+    ~FarmChannel() {
+      close();
+    }
+
+    int fd() const {
+      return fd_;
+    }
+
+    bool isOpen() const {
+      return fd_ >= 0;
+    }
+
+    void close() {
+      if (fd_ >= 0) ::close(fd_);
+
+      fd_ = -1;
+    }
+
+    /**
+     * @brief open takes ownership of fd, closes previous one
+     */
+    void open(int fd) {
+      close();
+      fd_ = fd;
+    }
+
+    /**
+     * @brief setTimeout limits blocking of send() and receive() (and of
+     * TCP connect() on Linux)
+     * @param timeout_ms - 0 blocks forever
+     */
+    void setTimeout(int timeout_ms) {
+      timeval timeout;
+
+      timeout.tv_sec = timeout_ms / 1000;
+      timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+      ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      ::setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+
+    bool send(Type type, const std::vector<unsigned char>& payload) {
+      std::vector<unsigned char> header;
+
+      putU32(header, static_cast<std::uint32_t>(type));
+      putU32(header, static_cast<std::uint32_t>(payload.size()));
+
+      return sendAll(header.data(), header.size()) && sendAll(payload.data(), payload.size());
+    }
+
+    /**
+     * @brief receive blocks until a whole message arrives
+     * @return false on end of stream, error, timeout or malformed frame
+     */
+    bool receive(Type& type, std::vector<unsigned char>& payload) {
+      unsigned char header[8];
+
+      if (!receiveAll(header, sizeof(header))) return false;
+
+      std::vector<unsigned char> header_bytes(header, header + sizeof(header));
+      Reader reader(header_bytes);
+
+      type = static_cast<Type>(reader.u32());
+
+      const std::uint32_t size = reader.u32();
+
+      if (size > MAX_PAYLOAD) return false;
+
+      payload.resize(size);
+
+      return receiveAll(payload.data(), size);
+    }
+
+    static void putU32(std::vector<unsigned char>& out, std::uint32_t value) {
+      for (unsigned int i = 0; i < 4; ++i) out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+
+    static void putU64(std::vector<unsigned char>& out, std::uint64_t value) {
+      for (unsigned int i = 0; i < 8; ++i) out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+
+    static void putF64(std::vector<unsigned char>& out, double value) {
+      std::uint64_t bits;
+
+      std::memcpy(&bits, &value, sizeof(bits));
+      putU64(out, bits);
+    }
+
+    static void putString(std::vector<unsigned char>& out, const std::string& value) {
+      putU32(out, static_cast<std::uint32_t>(value.size()));
+      out.insert(out.end(), value.begin(), value.end());
+    }
+
+    /**
+     * @brief putConfig appends result-relevant config fields and kernel name
+     */
+    static void putConfig(std::vector<unsigned char>& out, const JuliaSetGeneratorConfig& cfg, const std::string& kernel) {
+      putU32(out, cfg.width_);
+      putU32(out, cfg.height_);
+      putU32(out, cfg.max_iterations_);
+      putF64(out, cfg.c_realis_);
+      putF64(out, cfg.c_imaginalis_);
+      putF64(out, cfg.zoom_);
+      putF64(out, cfg.off_x_);
+      putF64(out, cfg.off_y_);
+      putString(out, kernel);
+    }
+
+    /**
+     * @brief readConfig reverses putConfig(), clears reader.ok() on
+     * empty frame or unknown kernel
+     */
+    static void readConfig(Reader& reader, JuliaSetGeneratorConfig& cfg, JuliaSetGenerator::Kernel& kernel) {
+      const unsigned int width = reader.u32(),
+                         height = reader.u32(),
+                         max_iterations = reader.u32();
+
+      cfg = JuliaSetGeneratorConfig(width, height, 0.0, 0.0, max_iterations);
+      cfg.c_realis_ = reader.f64();
+      cfg.c_imaginalis_ = reader.f64();
+      cfg.zoom_ = reader.f64();
+      cfg.off_x_ = reader.f64();
+      cfg.off_y_ = reader.f64();
+
+      if ((width == 0) || (height == 0) || !JuliaSetGenerator::kernelFromName(reader.string(), kernel)) reader.fail();
+    }
+
+  private:
+    bool sendAll(const unsigned char *data, std::size_t size) {
+      while (size > 0) {
+        // No SIGPIPE when the other side is gone, just an error
+        const ssize_t sent = ::send(fd_, data, size, MSG_NOSIGNAL);
+
+        if (sent <= 0) return false;
+
+        data += sent;
+        size -= static_cast<std::size_t>(sent);
+      }
+
+      return true;
+    }
+
+    bool receiveAll(unsigned char *data, std::size_t size) {
+      while (size > 0) {
+        const ssize_t received = ::recv(fd_, data, size, 0);
+
+        if (received <= 0) return false;
+
+        data += received;
+        size -= static_cast<std::size_t>(received);
+      }
+
+      return true;
+    }
+
+    int fd_;
+};
+
+/**
+ * @brief The SharedIterationBuffer class is a POSIX shared memory frame
+ * of iterations, local farm workers map it by name and write their
+ * tiles in place, so no pixel data goes through the sockets.
+ *
+ * The name is unlinked on destruction (a crashed coordinator leaves it
+ * in /dev/shm).
+ */
+class SharedIterationBuffer {
+  public:
+    SharedIterationBuffer() : data_(nullptr), size_(0) {
+    }
+
+    SharedIterationBuffer(const SharedIterationBuffer&) = delete;
+    SharedIterationBuffer& operator=(const SharedIterationBuffer&) = delete;
+
+    ~SharedIterationBuffer() {
+      release();
+    }
+
+    /**
+     * @brief create creates and maps a new segment
+     * @param count - number of iterations
+     * @return false if segment could not be created
+     */
+    bool create(std::size_t count) {
+      static std::uint64_t serial = 0;
+
+      release();
+
+      const std::string name = "/julia_farm_" + std::to_string(::getpid()) + "_" + std::to_string(++serial);
+      const std::size_t size = std::max<std::size_t>(1, count) * sizeof(unsigned int);
+
+      int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+      if (fd < 0) {
+        std::cerr << "SharedIterationBuffer::create(): Error - Could not create shared memory " << name << "!" << std::endl;
+        return false;
+      }
+
+      void *map = (::ftruncate(fd, static_cast<off_t>(size)) == 0)
+                  ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                  : MAP_FAILED;
+
+      ::close(fd);
+
+      if (map == MAP_FAILED) {
+        std::cerr << "SharedIterationBuffer::create(): Error - Could not map shared memory " << name << "!" << std::endl;
+        ::shm_unlink(name.c_str());
+        return false;
+      }
+
+      name_ = name;
+      data_ = static_cast<unsigned int *>(map);
+      size_ = size;
+
+      return true;
+    }
+
+    /**
+     * @brief open maps an existing segment (worker side)
+     * @param count - number of iterations, must match creator
+     */
+    bool open(const std::string& name, std::size_t count) {
+      release();
+
+      const std::size_t size = std::max<std::size_t>(1, count) * sizeof(unsigned int);
+
+      int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+
+      if (fd < 0) {
+        std::cerr << "SharedIterationBuffer::open(): Error - Could not open shared memory " << name << "!" << std::endl;
+        return false;
+      }
+
+      struct stat status;
+      void *map = ((::fstat(fd, &status) == 0) && (static_cast<std::size_t>(status.st_size) >= size))
+                  ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                  : MAP_FAILED;
+
+      ::close(fd);
+
+      if (map == MAP_FAILED) {
+        std::cerr << "SharedIterationBuffer::open(): Error - Could not map shared memory " << name << "!" << std::endl;
+        return false;
+      }
+
+      data_ = static_cast<unsigned int *>(map);
+      size_ = size;
+
+      return true;
+    }
+
+    /**
+     * @brief release unmaps the segment, unlinks it if created here
+     */
+    void release() {
+      if (data_) ::munmap(data_, size_);
+
+      if (!name_.empty()) ::shm_unlink(name_.c_str());
+
+      name_.clear();
+      data_ = nullptr;
+      size_ = 0;
+    }
+
+    unsigned int *data() const {
+      return data_;
+    }
+
+    const std::string& name() const {
+      return name_;
+    }
+
+  private:
+    std::string name_;
+    unsigned int *data_;
+    std::size_t size_;
+};
+
+/**
+ * @brief The RenderFarmWorker class computes tiles for a RenderFarm
+ * coordinator on its own render pool: a local worker process serves the
+ * socketpair it was started with, a remote one listens on TCP.
+ */
+class RenderFarmWorker {
+  public:
+    explicit RenderFarmWorker(std::shared_ptr<RenderPool> pool = RenderPool::global()) {
+      gen_.setRenderPool(pool);
+    }
+
+    /**
+     * @brief serve answers tile requests of one coordinator until it
+     * disconnects
+     * @param fd - connected socket, closed on return
+     * @param shared_memory - coordinator may name a shared memory frame to
+     * write tiles into; only for the socketpair of a local worker, a TCP
+     * peer could otherwise make the worker overwrite any segment its user owns
+     * @return false on protocol error
+     */
+    bool serve(int fd, bool shared_memory = false) {
+      FarmChannel channel(fd);
+      SharedIterationBuffer shared;
+      std::vector<unsigned int> tile;
+      std::vector<unsigned char> payload,
+                                 result;
+      FarmChannel::Type type;
+      bool configured = false;
+
+      while (channel.receive(type, payload)) {
+        FarmChannel::Reader reader(payload);
+
+        if (type == FarmChannel::Type::Config) {
+          JuliaSetGeneratorConfig cfg;
+          JuliaSetGenerator::Kernel kernel;
+
+          FarmChannel::readConfig(reader, cfg, kernel);
+
+          const std::string shared_name = reader.string();
+
+          if (!reader.ok()) {
+            std::cerr << "RenderFarmWorker::serve(): Error - Invalid frame config!" << std::endl;
+            return false;
+          }
+
+          gen_.setWidth(cfg.width_).setHeight(cfg.height_).setMaxIterations(cfg.max_iterations_).
+          setConstantRealis(cfg.c_realis_).setConstantImaginalis(cfg.c_imaginalis_).
+          setZoom(cfg.zoom_).setOffsetX(cfg.off_x_).setOffsetY(cfg.off_y_).setKernel(kernel);
+
+          shared.release();
+
+          if (!shared_name.empty() && !shared_memory) {
+            std::cerr << "RenderFarmWorker::serve(): Error - Shared memory frame requested over TCP!" << std::endl;
+            return false;
+          }
+
+          if (!shared_name.empty() && !shared.open(shared_name, static_cast<std::size_t>(cfg.width_) * cfg.height_)) return false;
+
+          configured = true;
+        } else if (type == FarmChannel::Type::Tile) {
+          const std::uint32_t id = reader.u32(),
+                              x = reader.u32(),
+                              y = reader.u32(),
+                              columns = reader.u32(),
+                              rows = reader.u32();
+          const JuliaSetGeneratorConfig& cfg = gen_.getConfig();
+
+          if (!reader.ok() || !configured || (columns == 0) || (rows == 0) ||
+              (x >= cfg.width_) || (columns > cfg.width_ - x) || (y >= cfg.height_) || (rows > cfg.height_ - y)) {
+            std::cerr << "RenderFarmWorker::serve(): Error - Invalid tile!" << std::endl;
+            return false;
+          }
+
+          result.clear();
+          FarmChannel::putU32(result, id);
+
+          if (shared.data()) {
+            FarmChannel::putU64(result, gen_.computeIterations(x, y, columns, rows,
+                                                               shared.data() + static_cast<std::size_t>(y) * cfg.width_ + x,
+                                                               cfg.width_));
+          } else {
+            tile.resize(static_cast<std::size_t>(columns) * rows);
+            FarmChannel::putU64(result, gen_.computeIterations(x, y, columns, rows, tile.data(), columns));
+            IterationCodec::encodeTile(tile.data(), columns, rows, columns, result);
+          }
+
+          if (!channel.send(FarmChannel::Type::Result, result)) return false;
+        } else {
+          std::cerr << "RenderFarmWorker::serve(): Error - Unexpected message!" << std::endl;
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    /**
+     * @brief listen serves coordinators connecting over TCP, one after
+     * another, forever
+     * @param address - [host:]port, host defaults to 127.0.0.1 (use
+     * 0.0.0.0 to accept other machines - there is no authentication)
+     * @return false if socket could not be set up
+     */
+    bool listen(const std::string& address) {
+      std::string host = "127.0.0.1",
+                  port = address;
+      const std::size_t colon = address.rfind(':');
+
+      if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+      }
+
+      addrinfo hints;
+      addrinfo *addresses = nullptr;
+
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = AI_PASSIVE;
+
+      if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        std::cerr << "RenderFarmWorker::listen(): Error - Could not resolve " << address << "!" << std::endl;
+        return false;
+      }
+
+      int fd = -1;
+
+      for (addrinfo *candidate = addresses; candidate && (fd < 0); candidate = candidate->ai_next) {
+        fd = ::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+
+        if (fd < 0) continue;
+
+        const int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if ((::bind(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) || (::listen(fd, 4) != 0)) {
+          ::close(fd);
+          fd = -1;
+        }
+      }
+
+      ::freeaddrinfo(addresses);
+
+      if (fd < 0) {
+        std::cerr << "RenderFarmWorker::listen(): Error - Could not listen on " << address << "!" << std::endl;
+        return false;
+      }
+
+      for (;;) {
+        const int connection = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (connection < 0) continue;
+
+        const int no_delay = 1;
+        ::setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        serve(connection);
+      }
+    }
+
+  private:
+    JuliaSetGenerator gen_;
+};
+
+/**
+ * @brief The RenderFarm class renders escape iterations of a frame on
+ * several worker processes, local (started here, tiles written straight
+ * into a SharedIterationBuffer) and/or remote (RenderFarmWorker::listen(),
+ * tiles sent back compressed by IterationCodec).
+ *
+ * Tiles are handed out a few at a time per worker (TILES_IN_FLIGHT), so
+ * faster workers take more of them. A worker that disconnects, sends
+ * garbage or does not answer within the timeout is dropped (local ones
+ * are killed) and its outstanding tiles go back to the queue; when no
+ * workers are left, the rest of the frame is computed in this process.
+ */
+class RenderFarm {
+  public:
+    constexpr static const unsigned int DEFAULT_TILE_SIZE = 256,
+                                        TILES_IN_FLIGHT = 2;
+    constexpr static const int DEFAULT_TIMEOUT_MS = 60000;
+
+    RenderFarm() : tile_size_(DEFAULT_TILE_SIZE), timeout_ms_(DEFAULT_TIMEOUT_MS) {
+    }
+
+    RenderFarm(const RenderFarm&) = delete;
+    RenderFarm& operator=(const RenderFarm&) = delete;
+
+    ~RenderFarm() {
+      for (std::size_t i = 0; i < workers_.size(); ++i) dropWorker(i);
+    }
+
+    /**
+     * @brief setTileSize
+     * @param tile_size - edge of square tiles handed to workers
+     * @return reference for "this"
+     */
+    RenderFarm& setTileSize(unsigned int tile_size) {
+      tile_size_ = std::max(1U, tile_size);
+      return *this;
+    }
+
+    /**
+     * @brief setTimeout
+     * @param timeout_ms - time a worker may take for a tile (or a message)
+     * before it is considered failed
+     * @return reference for "this"
+     */
+    RenderFarm& setTimeout(int timeout_ms) {
+      timeout_ms_ = std::max(1, timeout_ms);
+      return *this;
+    }
+
+    /**
+     * @brief addLocalWorkers starts worker processes, each gets its end of
+     * a socketpair as "--farm-worker-fd FD" after args
+     * @param count - number of processes
+     * @param executable - worker program (julia_batch)
+     * @param args - extra arguments, e.g. thread count
+     * @return false if a process could not be started
+     */
+    bool addLocalWorkers(unsigned int count, const std::string& executable, const std::vector<std::string>& args) {
+      for (unsigned int i = 0; i < count; ++i) {
+        int fds[2];
+
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+          std::cerr << "RenderFarm::addLocalWorkers(): Error - Could not create socket pair!" << std::endl;
+          return false;
+        }
+
+        // Argument vector is built before fork, child may only call async-signal-safe functions
+        std::vector<std::string> arguments(1, executable);
+
+        arguments.insert(arguments.end(), args.begin(), args.end());
+        arguments.push_back("--farm-worker-fd");
+        arguments.push_back(std::to_string(fds[1]));
+
+        std::vector<char *> argv;
+
+        for (std::string& argument : arguments) argv.push_back(&argument[0]);
+
+        argv.push_back(nullptr);
+
+        const pid_t pid = ::fork();
+
+        if (pid == 0) {
+          ::fcntl(fds[1], F_SETFD, 0);
+          ::execv(executable.c_str(), argv.data());
+          ::_exit(127);
+        }
+
+        ::close(fds[1]);
+
+        if (pid < 0) {
+          ::close(fds[0]);
+          std::cerr << "RenderFarm::addLocalWorkers(): Error - Could not start worker process!" << std::endl;
+          return false;
+        }
+
+        workers_.emplace_back(new Worker("local " + std::to_string(pid), fds[0], pid));
+        workers_.back()->channel.setTimeout(timeout_ms_);
+      }
+
+      return true;
+    }
+
+    /**
+     * @brief addRemoteWorker connects to a RenderFarmWorker::listen() worker
+     * @param address - host:port
+     * @return false if connection failed
+     */
+    bool addRemoteWorker(const std::string& address) {
+      const std::size_t colon = address.rfind(':');
+
+      if (colon == std::string::npos) {
+        std::cerr << "RenderFarm::addRemoteWorker(): Error - Missing port in " << address << "!" << std::endl;
+        return false;
+      }
+
+      const std::string host = address.substr(0, colon),
+                        port = address.substr(colon + 1);
+      addrinfo hints;
+      addrinfo *addresses = nullptr;
+
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+
+      if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        std::cerr << "RenderFarm::addRemoteWorker(): Error - Could not resolve " << address << "!" << std::endl;
+        return false;
+      }
+
+      std::unique_ptr<Worker> worker;
+
+      for (addrinfo *candidate = addresses; candidate && !worker; candidate = candidate->ai_next) {
+        const int fd = ::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+
+        if (fd < 0) continue;
+
+        worker.reset(new Worker(address, fd, -1));
+        worker->channel.setTimeout(timeout_ms_);
+
+        if (::connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) worker.reset();
+      }
+
+      ::freeaddrinfo(addresses);
+
+      if (!worker) {
+        std::cerr << "RenderFarm::addRemoteWorker(): Error - Could not connect to " << address << "!" << std::endl;
+        return false;
+      }
+
+      const int no_delay = 1;
+      ::setsockopt(worker->channel.fd(), IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+      workers_.push_back(std::move(worker));
+
+      return true;
+    }
+
+    /**
+     * @brief workerCount
+     * @return number of workers still alive
+     */
+    std::size_t workerCount() const {
+      return static_cast<std::size_t>(std::count_if(workers_.begin(), workers_.end(),
+                                                    [](const std::unique_ptr<Worker>& worker) {
+        return worker->channel.isOpen();
+      }));
+    }
+
+    /**
+     * @brief render computes iterations of gen's current frame on the farm
+     * @param gen - frame config and kernel, its pool computes tiles nobody
+     * else can
+     * @param stats - optional, iterations and pixels are added to it
+     * @return width * height iterations, row-major, valid until next
+     * render() or destruction, nullptr on failure
+     */
+    const unsigned int *render(JuliaSetGenerator& gen, RenderStats *stats = nullptr) {
+      const JuliaSetGeneratorConfig cfg = gen.getConfig();
+      const std::size_t count = static_cast<std::size_t>(cfg.width_) * cfg.height_;
+      const bool local_workers = std::any_of(workers_.begin(), workers_.end(),
+                                             [](const std::unique_ptr<Worker>& worker) {
+        return worker->pid > 0;
+      });
+
+      unsigned int *iterations = nullptr;
+
+      local_iterations_.clear();
+      shared_.release();
+
+      if (local_workers) {
+        if (!shared_.create(count)) return nullptr;
+
+        iterations = shared_.data();
+      } else {
+        local_iterations_.resize(count);
+        iterations = local_iterations_.data();
+      }
+
+      // Tiles in row-major order
+      std::vector<Tile> tiles;
+
+      for (unsigned int y = 0; y < cfg.height_; y += tile_size_) {
+        for (unsigned int x = 0; x < cfg.width_; x += tile_size_) {
+          tiles.push_back({ x, y, std::min(tile_size_, cfg.width_ - x), std::min(tile_size_, cfg.height_ - y) });
+        }
+      }
+
+      std::deque<std::uint32_t> pending;
+      std::vector<bool> done(tiles.size(), false);
+      std::size_t done_count = 0;
+      std::uint64_t executed = 0;
+
+      for (std::uint32_t i = 0; i < tiles.size(); ++i) pending.push_back(i);
+
+      for (std::size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = *workers_[i];
+
+        worker.in_flight.clear();
+
+        if (!worker.channel.isOpen()) continue;
+
+        std::vector<unsigned char> config;
+
+        FarmChannel::putConfig(config, cfg, gen.kernelName());
+        FarmChannel::putString(config, worker.pid > 0 ? shared_.name() : std::string());
+
+        if (!worker.channel.send(FarmChannel::Type::Config, config)) failWorker(i, pending);
+      }
+
+      std::vector<pollfd> polled;
+      std::vector<std::size_t> polled_workers;
+      std::vector<unsigned char> payload;
+
+      while (done_count < tiles.size()) {
+        // Top up every worker to TILES_IN_FLIGHT
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+          Worker& worker = *workers_[i];
+
+          while (worker.channel.isOpen() && !pending.empty() && (worker.in_flight.size() < TILES_IN_FLIGHT)) {
+            const std::uint32_t id = pending.front();
+            const Tile& tile = tiles[id];
+            std::vector<unsigned char> request;
+
+            pending.pop_front();
+
+            if (done[id]) continue;
+
+            FarmChannel::putU32(request, id);
+            FarmChannel::putU32(request, tile.x);
+            FarmChannel::putU32(request, tile.y);
+            FarmChannel::putU32(request, tile.columns);
+            FarmChannel::putU32(request, tile.rows);
+
+            if (worker.in_flight.empty()) worker.last_progress = std::chrono::steady_clock::now();
+
+            worker.in_flight.push_back(id);
+
+            if (!worker.channel.send(FarmChannel::Type::Tile, request)) failWorker(i, pending);
+          }
+        }
+
+        if (workerCount() == 0) {
+          // Nobody left, finish here
+          for (const std::uint32_t id : pending) {
+            if (done[id]) continue;
+
+            const Tile& tile = tiles[id];
+
+            executed += gen.computeIterations(tile.x, tile.y, tile.columns, tile.rows,
+                                              iterations + static_cast<std::size_t>(tile.y) * cfg.width_ + tile.x,
+                                              cfg.width_);
+            done[id] = true;
+            ++done_count;
+          }
+
+          pending.clear();
+          break;
+        }
+
+        polled.clear();
+        polled_workers.clear();
+
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+          if (!workers_[i]->channel.isOpen() || workers_[i]->in_flight.empty()) continue;
+
+          polled.push_back({ workers_[i]->channel.fd(), POLLIN, 0 });
+          polled_workers.push_back(i);
+        }
+
+        ::poll(polled.data(), static_cast<nfds_t>(polled.size()), POLL_INTERVAL_MS);
+
+        const auto now = std::chrono::steady_clock::now();
+
+        for (std::size_t p = 0; p < polled.size(); ++p) {
+          const std::size_t i = polled_workers[p];
+          Worker& worker = *workers_[i];
+
+          if (!polled[p].revents) {
+            if (now - worker.last_progress > std::chrono::milliseconds(timeout_ms_)) {
+              std::cerr << "RenderFarm: worker " << worker.name << " timed out" << std::endl;
+              failWorker(i, pending);
+            }
+
+            continue;
+          }
+
+          FarmChannel::Type type;
+
+          if (!worker.channel.receive(type, payload) || (type != FarmChannel::Type::Result)) {
+            failWorker(i, pending);
+            continue;
+          }
+
+          FarmChannel::Reader reader(payload);
+          const std::uint32_t id = reader.u32();
+          const std::uint64_t tile_executed = reader.u64();
+          const auto position = std::find(worker.in_flight.begin(), worker.in_flight.end(), id);
+
+          if (!reader.ok() || (position == worker.in_flight.end())) {
+            failWorker(i, pending);
+            continue;
+          }
+
+          if (worker.pid <= 0) {
+            const Tile& tile = tiles[id];
+
+            if (!IterationCodec::decodeTile(reader.position(), reader.end(),
+                                               iterations + static_cast<std::size_t>(tile.y) * cfg.width_ + tile.x,
+                                               tile.columns, tile.rows, cfg.width_)) {
+              failWorker(i, pending);
+              continue;
+            }
+          }
+
+          worker.in_flight.erase(position);
+          worker.last_progress = now;
+
+          if (!done[id]) {
+            done[id] = true;
+            ++done_count;
+            executed += tile_executed;
+          }
+        }
+      }
+
+      if (stats) {
+        stats->iterations += executed;
+        stats->pixels += count;
+      }
+
+      return iterations;
+    }
+
+  private:
+    constexpr static const int POLL_INTERVAL_MS = 100;
+
+    struct Tile {
+      unsigned int x,
+                   y,
+                   columns,
+                   rows;
+    };
+
+    struct Worker {
+      Worker(const std::string& worker_name, int fd, pid_t worker_pid)
+        : name(worker_name), channel(fd), pid(worker_pid) {
+      }
+
+      std::string name;
+      FarmChannel channel;
+      pid_t pid; //!< local worker process, -1 for remote
+      std::vector<std::uint32_t> in_flight;
+      std::chrono::steady_clock::time_point last_progress;
+    };
+
+    /**
+     * @brief dropWorker disconnects worker, kills and reaps a local process
+     * (it must not write into shared memory after its tiles were reassigned)
+     */
+    void dropWorker(std::size_t index) {
+      Worker& worker = *workers_[index];
+
+      worker.channel.close();
+
+      if (worker.pid > 0) {
+        ::kill(worker.pid, SIGKILL);
+        ::waitpid(worker.pid, nullptr, 0);
+        worker.pid = 0;
+      }
+    }
+
+    void failWorker(std::size_t index, std::deque<std::uint32_t>& pending) {
+      Worker& worker = *workers_[index];
+
+      if (!worker.channel.isOpen()) return;
+
+      std::cerr << "RenderFarm: worker " << worker.name << " failed, "
+                << worker.in_flight.size() << " tiles reassigned" << std::endl;
+
+      dropWorker(index);
+      pending.insert(pending.begin(), worker.in_flight.begin(), worker.in_flight.end());
+      worker.in_flight.clear();
+    }
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    SharedIterationBuffer shared_;
+    std::vector<unsigned int> local_iterations_;
+    unsigned int tile_size_;
+    int timeout_ms_;
+};
+
+#endif // _WIN32
+
+#endif // RENDER_FARM_H
@@ -0,0 +1,178 @@
+#ifndef RENDER_POOL_H
+#define RENDER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <render_trace.h>
+
+/**
+ * @brief The RenderPool class is a fixed size pool of worker threads
+ * used to split rendering work (rows, strips, tiles...) across cores.
+ *
+ * Work is submitted with parallelFor(), which hands out item indices
+ * dynamically (one atomic counter), so uneven item cost is balanced
+ * automatically. The calling thread takes part in the work too.
+ *
+ * parallelFor() calls are serialized. Calling parallelFor() from
+ * inside a task of the same pool dead-locks.
+ */
+class RenderPool {
+  public:
+    /**
+     * @brief RenderPool
+     * @param threads - total number of threads working on a job
+     * (including caller), 0 means one per hardware thread
+     */
+    explicit RenderPool(unsigned int threads = 0)
+      : task_(nullptr), count_(0), next_(0), generation_(0), pending_(0), stop_(false) {
+      if (threads == 0) threads = std::thread::hardware_concurrency();
+
+      if (threads == 0) threads = 1;
+
+      for (unsigned int i = 1; i < threads; ++i) {
+        workers_.emplace_back(&RenderPool::workerLoop, this, i);
+      }
+    }
+
+    RenderPool(const RenderPool&) = delete;
+    RenderPool& operator=(const RenderPool&) = delete;
+
+    ~RenderPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+
+      for (auto& worker : workers_) worker.join();
+    }
+
+    /**
+     * @brief threadCount
+     * @return number of threads taking part in parallelFor() (workers + caller)
+     */
+    unsigned int threadCount() const {
+      return static_cast<unsigned int>(workers_.size()) + 1;
+    }
+
+    /**
+     * @brief parallelFor runs task(i) for every i in [0, count) and
+     * returns when all of them are finished.
+     * @param count - number of work items
+     * @param task - work item function, called concurrently
+     */
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task) {
+      if (count == 0) return;
+
+      std::lock_guard<std::mutex> submit(submit_mutex_);
+
+      RenderTrace::global().instant("parallelFor", "pool", "items", static_cast<std::int64_t>(count));
+
+      if (workers_.empty() || (count == 1)) {
+        for (std::size_t i = 0; i < count; ++i) task(i);
+
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_.store(0);
+        pending_ = workers_.size();
+        ++generation_;
+      }
+      wake_.notify_all();
+
+      runTasks(task, count);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] {
+        return pending_ == 0;
+      });
+      task_ = nullptr;
+    }
+
+    /**
+     * @brief currentThreadIndex
+     * @return index of calling thread inside its pool: 1..threadCount()-1
+     * for pool workers, 0 for any other thread (parallelFor() caller)
+     */
+    static unsigned int currentThreadIndex() {
+      return threadIndexSlot();
+    }
+
+    /**
+     * @brief global
+     * @return process wide pool with one thread per hardware thread
+     */
+    static std::shared_ptr<RenderPool> global() {
+      static std::shared_ptr<RenderPool> pool = std::make_shared<RenderPool>();
+
+      return pool;
+    }
+
+  private:
+    static unsigned int& threadIndexSlot() {
+      static thread_local unsigned int index = 0;
+
+      return index;
+    }
+
+    void runTasks(const std::function<void(std::size_t)>& task, std::size_t count) {
+      for (std::size_t i = next_.fetch_add(1); i < count; i = next_.fetch_add(1)) {
+        task(i);
+      }
+    }
+
+    void workerLoop(unsigned int index) {
+      std::size_t seen_generation = 0;
+
+      threadIndexSlot() = index;
+      RenderTrace::global().setThreadName("RenderPool worker " + std::to_string(index));
+
+      for (;;) {
+        const std::function<void(std::size_t)> *task;
+        std::size_t count;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          wake_.wait(lock, [this, seen_generation] {
+            return stop_ || (generation_ != seen_generation);
+          });
+
+          if (stop_) return;
+
+          seen_generation = generation_;
+          task = task_;
+          count = count_;
+        }
+
+        runTasks(*task, count);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (--pending_ == 0) done_.notify_one();
+      }
+    }
+
+    std::vector<std::thread> workers_;
+
+    std::mutex submit_mutex_,
+               mutex_;
+    std::condition_variable wake_,
+                            done_;
+
+    const std::function<void(std::size_t)> *task_;
+    std::size_t count_;
+    std::atomic<std::size_t> next_;
+    std::size_t generation_,
+                pending_;
+    bool stop_;
+};
+
+#endif // RENDER_POOL_H
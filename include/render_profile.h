@@ -0,0 +1,72 @@
+#ifndef RENDER_PROFILE_H
+#define RENDER_PROFILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The RenderProfile struct holds detailed cost data of one
+ * rendered frame: iteration count of every pixel and compute time and
+ * executing thread of every tile. Filled by JuliaSetGenerator when
+ * requested, used for heatmap overlays and load balance analysis.
+ */
+struct RenderProfile {
+  unsigned int width = 0,
+               height = 0,
+               tile_size = 0,
+               max_iterations = 0;
+
+  std::vector<unsigned int> iterations;     //!< per pixel, row-major, UINT_MAX for interior
+  std::vector<std::int64_t> tile_ns;        //!< per tile compute time, row-major
+  std::vector<unsigned int> tile_thread;    //!< per tile RenderPool thread index
+  std::vector<std::int64_t> thread_busy_ns; //!< per pool thread summed tile time
+
+  /**
+   * @brief reset prepares empty profile for frame of given size
+   */
+  void reset(unsigned int frame_width, unsigned int frame_height, unsigned int tile,
+             unsigned int frame_max_iterations, unsigned int threads) {
+    width = frame_width;
+    height = frame_height;
+    tile_size = tile;
+    max_iterations = frame_max_iterations;
+
+    iterations.assign(static_cast<std::size_t>(width) * height, 0);
+    tile_ns.assign(static_cast<std::size_t>(tileColumns()) * tileRows(), 0);
+    tile_thread.assign(tile_ns.size(), 0);
+    thread_busy_ns.assign(threads, 0);
+  }
+
+  unsigned int tileColumns() const {
+    return tile_size ? (width + tile_size - 1) / tile_size : 0;
+  }
+
+  unsigned int tileRows() const {
+    return tile_size ? (height + tile_size - 1) / tile_size : 0;
+  }
+
+  std::int64_t maxTileNs() const {
+    return tile_ns.empty() ? 0 : *std::max_element(tile_ns.begin(), tile_ns.end());
+  }
+
+  /**
+   * @brief threadImbalance
+   * @return busiest thread time / mean thread time, 1.0 is perfect balance
+   */
+  double threadImbalance() const {
+    if (thread_busy_ns.empty()) return 1.0;
+
+    std::int64_t total = 0,
+                 busiest = 0;
+
+    for (std::int64_t ns : thread_busy_ns) {
+      total += ns;
+      busiest = std::max(busiest, ns);
+    }
+
+    return total > 0 ? static_cast<double>(busiest) * thread_busy_ns.size() / total : 1.0;
+  }
+};
+
+#endif // RENDER_PROFILE_H
@@ -0,0 +1,48 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <cstdint>
+
+/**
+ * @brief The RenderStats struct holds per-stage timings and throughput
+ * counters of one rendered frame, from render request to pixmap in the
+ * scene.
+ *
+ * Generator stages (kernel, colorize) and counters are filled by
+ * JuliaSetGenerator, the rest by the GUI pipeline.
+ *
+ * All durations are wall-clock nanoseconds.
+ */
+struct RenderStats {
+  std::int64_t queue_wait_ns = 0,   //!< render request to worker thread start
+               generate_ns = 0,     //!< JuliaSetGenerator::generate() in worker thread
+               kernel_ns = 0,       //!< escape-time iterations, part of generate_ns
+               colorize_ns = 0,     //!< iterations to colour, part of generate_ns
+               get_image_ns = 0,    //!< bitmap_image::get_image() BMP serialization
+               from_data_ns = 0,    //!< QImage::fromData() BMP decode
+               from_image_ns = 0,   //!< QPixmap::fromImage() upload
+               scene_update_ns = 0, //!< scene clear, addPixmap, setSceneRect, setScene
+               fit_in_view_ns = 0,  //!< QGraphicsView::fitInView()
+               total_ns = 0;        //!< render request to scene updated
+
+  std::uint64_t iterations = 0,     //!< escape-time iterations executed
+                pixels = 0;         //!< pixels rendered
+
+  /**
+   * @brief pixelsPerSecond
+   * @return rendered pixels per second of generate() time
+   */
+  double pixelsPerSecond() const {
+    return generate_ns > 0 ? pixels * 1e9 / generate_ns : 0.0;
+  }
+
+  /**
+   * @brief iterationsPerSecond
+   * @return escape-time iterations per second of kernel time
+   */
+  double iterationsPerSecond() const {
+    return kernel_ns > 0 ? iterations * 1e9 / kernel_ns : 0.0;
+  }
+};
+
+#endif // RENDER_STATS_H
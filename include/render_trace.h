@@ -0,0 +1,303 @@
+#ifndef RENDER_TRACE_H
+#define RENDER_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The RenderTrace class records timeline events of the render
+ * path (job submission, tile execution, colourization, UI handoff...)
+ * and writes them as Chrome trace_event JSON, viewable in
+ * chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Every thread writes into its own fixed size ring buffer, so recording
+ * takes no lock: one relaxed load when tracing is off, two clock reads
+ * and one release store when it is on. Ring buffers keep only the newest
+ * EVENTS_PER_THREAD events of each thread.
+ *
+ * Event names, categories and argument names must be string literals
+ * (only pointers are stored). Events being overwritten while
+ * writeJson() copies them are dropped from the output.
+ */
+class RenderTrace {
+  public:
+    constexpr static const std::size_t EVENTS_PER_THREAD = 1 << 16;
+
+    /**
+     * @brief global
+     * @return process wide trace, disabled by default
+     */
+    static RenderTrace& global() {
+      static RenderTrace trace;
+
+      return trace;
+    }
+
+    void setEnabled(bool enabled) {
+      enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool enabled() const {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief now
+     * @return trace clock in ns
+     */
+    static std::int64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief complete records event with duration ("X" phase)
+     * @param name - event name, string literal
+     * @param category - event category, string literal
+     * @param start_ns - now() at start
+     * @param end_ns - now() at end
+     * @param arg_name - optional argument name, string literal
+     * @param arg - argument value
+     */
+    void complete(const char *name, const char *category, std::int64_t start_ns, std::int64_t end_ns,
+                  const char *arg_name = nullptr, std::int64_t arg = 0) {
+      if (!enabled()) return;
+
+      record({ name, category, arg_name, start_ns, end_ns - start_ns, arg, 'X' });
+    }
+
+    /**
+     * @brief instant records point in time event ("i" phase)
+     */
+    void instant(const char *name, const char *category, const char *arg_name = nullptr, std::int64_t arg = 0) {
+      if (!enabled()) return;
+
+      record({ name, category, arg_name, now(), 0, arg, 'i' });
+    }
+
+    /**
+     * @brief setThreadName names calling thread in the timeline
+     * @param name - thread name
+     */
+    void setThreadName(const std::string& name) {
+      ThreadSlot& slot = threadSlot();
+
+      slot.name = name;
+
+      if (slot.buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot.buffer->name = name;
+      }
+    }
+
+    /**
+     * @brief clear drops recorded events of all threads
+     */
+    void clear() {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      for (auto& buffer : buffers_) buffer->tail.store(buffer->head.load(std::memory_order_acquire));
+    }
+
+    /**
+     * @brief writeJson writes recorded events as Chrome trace_event JSON
+     */
+    void writeJson(std::ostream& stream) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+      bool first = true;
+
+      for (const auto& buffer : buffers_) {
+        stream << (first ? "" : ",\n")
+               << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << buffer->tid
+               << ", \"args\": {\"name\": \"" << buffer->name << "\"}}";
+        first = false;
+
+        for (const Event& event : snapshot(*buffer)) {
+          stream << ",\n{\"ph\": \"" << event.phase << "\", \"name\": \"" << event.name
+                 << "\", \"cat\": \"" << event.category << "\", \"pid\": 1, \"tid\": " << buffer->tid
+                 << ", \"ts\": " << (event.start_ns - epoch_ns_) / 1000 << "." << pad3((event.start_ns - epoch_ns_) % 1000);
+
+          if (event.phase == 'X') stream << ", \"dur\": " << event.duration_ns / 1000 << "." << pad3(event.duration_ns % 1000);
+          else stream << ", \"s\": \"t\"";
+
+          if (event.arg_name) stream << ", \"args\": {\"" << event.arg_name << "\": " << event.arg << "}";
+
+          stream << "}";
+        }
+      }
+
+      stream << "\n]}\n";
+    }
+
+    /**
+     * @brief writeJson writes recorded events to file
+     * @return false on write error
+     */
+    bool writeJson(const std::string& file_name) {
+      std::ofstream stream(file_name.c_str());
+
+      if (!stream) {
+        std::cerr << "RenderTrace::writeJson(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return false;
+      }
+
+      writeJson(stream);
+
+      return stream.good();
+    }
+
+  private:
+    struct Event {
+      const char *name,
+                 *category,
+                 *arg_name;
+      std::int64_t start_ns,
+                   duration_ns,
+                   arg;
+      char phase;
+    };
+
+    /**
+     * Single producer ring buffer. head is only written by the owning
+     * thread, readers copy events and drop the ones overwritten meanwhile.
+     */
+    struct ThreadBuffer {
+      explicit ThreadBuffer(unsigned int id) : tid(id), events(EVENTS_PER_THREAD), head(0), tail(0), in_use(true) {
+      }
+
+      const unsigned int tid;
+      std::string name;
+      std::vector<Event> events;
+      std::atomic<std::uint64_t> head,
+                                 tail;
+      bool in_use; //!< owned by a live thread, guarded by mutex_
+    };
+
+    /**
+     * Buffer of a finished thread goes back to the pool, so threads
+     * created per frame (QThread workers) do not grow memory.
+     */
+    struct ThreadSlot {
+      ThreadBuffer *buffer = nullptr;
+      std::string name;
+
+      ~ThreadSlot() {
+        if (buffer) RenderTrace::global().release(buffer);
+      }
+    };
+
+    RenderTrace() : enabled_(false), epoch_ns_(now()) {
+    }
+
+    static ThreadSlot& threadSlot() {
+      static thread_local ThreadSlot slot;
+
+      return slot;
+    }
+
+    void record(const Event& event) {
+      ThreadSlot& slot = threadSlot();
+
+      if (!slot.buffer) slot.buffer = acquire(slot.name);
+
+      ThreadBuffer& buffer = *slot.buffer;
+      const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+      buffer.events[head % EVENTS_PER_THREAD] = event;
+      buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    ThreadBuffer *acquire(const std::string& name) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      for (auto& buffer : buffers_) {
+        if (!buffer->in_use) {
+          buffer->in_use = true;
+
+          if (!name.empty()) buffer->name = name;
+
+          return buffer.get();
+        }
+      }
+
+      buffers_.push_back(std::make_unique<ThreadBuffer>(static_cast<unsigned int>(buffers_.size() + 1)));
+      buffers_.back()->name = name.empty() ? "thread " + std::to_string(buffers_.size()) : name;
+
+      return buffers_.back().get();
+    }
+
+    void release(ThreadBuffer *buffer) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      buffer->in_use = false;
+    }
+
+    static std::vector<Event> snapshot(const ThreadBuffer& buffer) {
+      const std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+      std::uint64_t first = std::max(buffer.tail.load(), head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0);
+      std::vector<Event> events;
+
+      for (std::uint64_t i = first; i < head; ++i) events.push_back(buffer.events[i % EVENTS_PER_THREAD]);
+
+      // Owner may have wrapped around while copying, drop overwritten events
+      const std::uint64_t new_head = buffer.head.load(std::memory_order_acquire);
+
+      if (new_head > first + EVENTS_PER_THREAD) {
+        events.erase(events.begin(), events.begin() + std::min<std::uint64_t>(
+                       events.size(), new_head - EVENTS_PER_THREAD - first));
+      }
+
+      return events;
+    }
+
+    static std::string pad3(std::int64_t value) {
+      std::string digits = std::to_string(value < 0 ? -value : value);
+
+      return std::string(3 - std::min<std::size_t>(3, digits.size()), '0') + digits;
+    }
+
+    std::atomic<bool> enabled_;
+    const std::int64_t epoch_ns_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer> > buffers_;
+};
+
+/**
+ * @brief The RenderTraceScope class records complete event of its
+ * lifetime into RenderTrace::global()
+ */
+class RenderTraceScope {
+  public:
+    RenderTraceScope(const char *name, const char *category, const char *arg_name = nullptr, std::int64_t arg = 0)
+      : name_(name), category_(category), arg_name_(arg_name), arg_(arg),
+      start_ns_(RenderTrace::global().enabled() ? RenderTrace::now() : 0) {
+    }
+
+    ~RenderTraceScope() {
+      if (start_ns_ != 0) RenderTrace::global().complete(name_, category_, start_ns_, RenderTrace::now(), arg_name_, arg_);
+    }
+
+    RenderTraceScope(const RenderTraceScope&) = delete;
+    RenderTraceScope& operator=(const RenderTraceScope&) = delete;
+
+  private:
+    const char *name_,
+               *category_,
+               *arg_name_;
+    std::int64_t arg_;
+    std::int64_t start_ns_;
+};
+
+#endif // RENDER_TRACE_H
@@ -0,0 +1,237 @@
+#ifndef TILE_PYRAMID_EXPORTER_H
+#define TILE_PYRAMID_EXPORTER_H
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <julia_set_generator.h>
+#include <image_encoder.h>
+
+/**
+ * @brief The TilePyramidExporter class exports generator image as a
+ * deep-zoom tile pyramid for web viewers (OpenSeadragon, Leaflet...).
+ *
+ * Layouts:
+ * - DZI: <name>.dzi descriptor + <name>_files/<level>/<col>_<row>.<ext>,
+ *   levels from 0 (1x1 pixel) to ceil(log2(max(width, height)))
+ * - XYZ: <name>/<z>/<x>/<y>.<ext>, z = 0 is the single tile level
+ *
+ * Tiles are encoded with ImageEncoder (BMP, QOI or PNG).
+ *
+ * Base level tiles are rendered one by one on the generator pool.
+ * Pyramid is walked depth first (quadtree), each parent tile is
+ * downsampled from its 4 children as soon as they are done, so only
+ * up to 4 tiles per level are alive at once - peak memory depends on
+ * tile size and level count, not on image size.
+ */
+class TilePyramidExporter {
+  public:
+    enum class Layout {
+      DZI,
+      XYZ
+    };
+
+    /**
+     * @brief TilePyramidExporter
+     * @param generator - configured generator, its width/height is the base level size
+     * @param tile_size - tile edge in pixels, rounded down to even
+     * @param layout - output directory layout
+     * @param format - tile image format
+     */
+    TilePyramidExporter(JuliaSetGenerator&    generator,
+                        unsigned int          tile_size = 256,
+                        Layout                layout = Layout::DZI,
+                        ImageEncoder::Format  format = ImageEncoder::Format::BMP)
+      : generator_(generator), tile_size_(tile_size >= 2 ? (tile_size & ~1U) : 256), layout_(layout),
+      format_(format), width_(0), height_(0), max_level_(0), root_level_(0), ok_(true) {
+    }
+
+    /**
+     * @brief exportTo renders and writes whole pyramid
+     * @param name - DZI: descriptor path without ".dzi", XYZ: root directory
+     * @return false on write error
+     */
+    bool exportTo(const std::string& name) {
+      width_ = generator_.getConfig().width_;
+      height_ = generator_.getConfig().height_;
+      name_ = name;
+      ok_ = true;
+
+      max_level_ = 0;
+
+      while ((1ULL << max_level_) < std::max(width_, height_)) ++max_level_;
+
+      root_level_ = max_level_;
+
+      while ((tileColumns(root_level_) > 1) || (tileRows(root_level_) > 1)) --root_level_;
+
+      std::shared_ptr<bitmap_image> tile = buildTile(root_level_, 0, 0);
+
+      // Levels below single tile level exist only in DZI
+      if (layout_ == Layout::DZI) {
+        for (unsigned int level = root_level_; ok_ && (level > 0); --level) {
+          auto parent = std::make_shared<bitmap_image>(levelWidth(level - 1), levelHeight(level - 1));
+          downsampleInto(*tile, *parent, 0, 0);
+          tile = parent;
+          writeTile(tile, level - 1, 0, 0);
+        }
+      }
+
+      if (pending_write_.valid() && !pending_write_.get()) ok_ = false;
+
+      if (ok_ && (layout_ == Layout::DZI)) ok_ = writeDescriptor();
+
+      return ok_;
+    }
+
+  private:
+    unsigned int levelWidth(unsigned int level) const {
+      return static_cast<unsigned int>((width_ + (1ULL << (max_level_ - level)) - 1) >> (max_level_ - level));
+    }
+
+    unsigned int levelHeight(unsigned int level) const {
+      return static_cast<unsigned int>((height_ + (1ULL << (max_level_ - level)) - 1) >> (max_level_ - level));
+    }
+
+    unsigned int tileColumns(unsigned int level) const {
+      return (levelWidth(level) + tile_size_ - 1) / tile_size_;
+    }
+
+    unsigned int tileRows(unsigned int level) const {
+      return (levelHeight(level) + tile_size_ - 1) / tile_size_;
+    }
+
+    /**
+     * @brief buildTile renders (base level) or downsamples (upper levels)
+     * tile and writes it
+     * @return tile image, needed by parent
+     */
+    std::shared_ptr<bitmap_image> buildTile(unsigned int level, unsigned int column, unsigned int row) {
+      std::shared_ptr<bitmap_image> tile;
+
+      if (level == max_level_) {
+        tile = generator_.generateRegion(column * tile_size_, row * tile_size_, tile_size_, tile_size_);
+      } else {
+        tile = std::make_shared<bitmap_image>(
+          std::min(tile_size_, levelWidth(level) - column * tile_size_),
+          std::min(tile_size_, levelHeight(level) - row * tile_size_));
+
+        for (unsigned int q = 0; ok_ && (q < 4); ++q) {
+          const unsigned int child_column = 2 * column + (q & 1);
+          const unsigned int child_row = 2 * row + (q >> 1);
+
+          if ((child_column >= tileColumns(level + 1)) || (child_row >= tileRows(level + 1))) continue;
+
+          std::shared_ptr<bitmap_image> child = buildTile(level + 1, child_column, child_row);
+
+          downsampleInto(*child, *tile, (q & 1) * tile_size_ / 2, (q >> 1) * tile_size_ / 2);
+        }
+      }
+
+      if (ok_) writeTile(tile, level, column, row);
+
+      return tile;
+    }
+
+    /**
+     * @brief downsampleInto 2x2 box filter of source into dest at (x, y).
+     * Odd source edges average only existing pixels.
+     */
+    static void downsampleInto(const bitmap_image& source, bitmap_image& dest,
+                               unsigned int x_offset, unsigned int y_offset) {
+      const unsigned int w = (source.width() + 1) / 2;
+      const unsigned int h = (source.height() + 1) / 2;
+
+      for (unsigned int y = 0; y < h; ++y) {
+        const unsigned int sy0 = 2 * y;
+        const unsigned int sy1 = std::min(sy0 + 1, source.height() - 1);
+        const unsigned char *row0 = source.row(sy0);
+        const unsigned char *row1 = source.row(sy1);
+        unsigned char *out = dest.row(y + y_offset) + 3 * x_offset;
+
+        for (unsigned int x = 0; x < w; ++x) {
+          const unsigned int sx0 = 3 * (2 * x);
+          const unsigned int sx1 = 3 * std::min(2 * x + 1, source.width() - 1);
+
+          for (unsigned int c = 0; c < 3; ++c) {
+            *(out++) = static_cast<unsigned char>(
+              (row0[sx0 + c] + row0[sx1 + c] + row1[sx0 + c] + row1[sx1 + c] + 2) / 4);
+          }
+        }
+      }
+    }
+
+    std::string tilePath(unsigned int level, unsigned int column, unsigned int row) const {
+      if (layout_ == Layout::DZI) {
+        return name_ + "_files/" + std::to_string(level) + "/" +
+               std::to_string(column) + "_" + std::to_string(row) + "." + ImageEncoder::extension(format_);
+      }
+
+      return name_ + "/" + std::to_string(level - root_level_) + "/" +
+             std::to_string(column) + "/" + std::to_string(row) + "." + ImageEncoder::extension(format_);
+    }
+
+    /**
+     * @brief writeTile saves tile asynchronously, overlapping with rendering
+     * of the next one. At most one write is in flight.
+     */
+    void writeTile(std::shared_ptr<bitmap_image> tile, unsigned int level, unsigned int column, unsigned int row) {
+      if (pending_write_.valid() && !pending_write_.get()) {
+        ok_ = false;
+        return;
+      }
+
+      const std::string path = tilePath(level, column, row);
+
+      pending_write_ = std::async(std::launch::async, [this, tile, path] {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+        if (error) {
+          std::cerr << "TilePyramidExporter::writeTile(): Error - Could not create directory for "
+                    << path << "!" << std::endl;
+          return false;
+        }
+
+        return encoder_.save(*tile, path, format_);
+      });
+    }
+
+    bool writeDescriptor() const {
+      const std::string file_name = name_ + ".dzi";
+      std::ofstream stream(file_name.c_str());
+
+      if (!stream) {
+        std::cerr << "TilePyramidExporter::writeDescriptor(): Error - Could not open file "
+                  << file_name << " for writing!" << std::endl;
+        return false;
+      }
+
+      stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+             << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\""
+             << tile_size_ << "\" Overlap=\"0\" Format=\"" << ImageEncoder::extension(format_) << "\">\n"
+             << "  <Size Width=\"" << width_ << "\" Height=\"" << height_ << "\"/>\n"
+             << "</Image>\n";
+
+      return stream.good();
+    }
+
+    JuliaSetGenerator& generator_;
+    unsigned int tile_size_;
+    Layout layout_;
+    ImageEncoder::Format format_;
+    ImageEncoder encoder_;
+
+    unsigned int width_,
+                 height_,
+                 max_level_,
+                 root_level_;
+    std::string name_;
+    bool ok_;
+    std::future<bool> pending_write_;
+};
+
+#endif // TILE_PYRAMID_EXPORTER_H
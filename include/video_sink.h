@@ -0,0 +1,259 @@
+#ifndef VIDEO_SINK_H
+#define VIDEO_SINK_H
+
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <bitmap_image.hpp>
+
+/**
+ * @brief The VideoSink class streams rendered frames into a single
+ * uncompressed video stream instead of one BMP per frame.
+ *
+ * Supported formats:
+ * - Y4M (YUV4MPEG2, 4:4:4 planar) - playable/encodable by ffmpeg, mpv, x264...
+ * - raw packed RGB24 - for piping into "ffmpeg -f rawvideo -pix_fmt rgb24"
+ *
+ * Output goes to a file or to stdout when path is "-".
+ *
+ * Frames are converted and written by a dedicated writer thread. The
+ * frame queue is bounded: push() blocks while the queue is full, so a
+ * renderer producing faster than the disk/pipe can take is throttled
+ * and memory stays at most max_queued_frames images.
+ *
+ * A write error (full disk, consumer closed the pipe) fails the sink:
+ * queued frames are dropped, push() and close() return false.
+ */
+class VideoSink {
+  public:
+    enum class Format {
+      Y4M,
+      RawRGB
+    };
+
+    /**
+     * @brief VideoSink opens output and starts the writer thread
+     * @param path - output file name, "-" for stdout
+     * @param width - frame width in pixels, every pushed frame must match
+     * @param height - frame height in pixels, every pushed frame must match
+     * @param fps - frames per second written to Y4M header
+     * @param format - output stream format
+     * @param max_queued_frames - frames buffered before push() blocks
+     */
+    VideoSink(const std::string& path,
+              unsigned int       width,
+              unsigned int       height,
+              unsigned int       fps = 30,
+              Format             format = Format::Y4M,
+              std::size_t        max_queued_frames = 4)
+      : width_(width), height_(height), fps_(fps), format_(format),
+      max_queued_(max_queued_frames > 0 ? max_queued_frames : 1),
+      out_(nullptr), closed_(false), failed_(false), frames_written_(0) {
+      if (path == "-") {
+        out_ = &std::cout;
+      } else {
+        file_.open(path.c_str(), std::ios::binary);
+
+        if (!file_) {
+          std::cerr << "VideoSink::VideoSink(): Error - Could not open file "
+                    << path << " for writing!" << std::endl;
+          closed_ = true;
+          return;
+        }
+
+        out_ = &file_;
+      }
+
+      if (format_ == Format::Y4M) {
+        *out_ << "YUV4MPEG2 W" << width_ << " H" << height_
+              << " F" << fps_ << ":1 Ip A1:1 C444\n";
+      }
+
+      writer_ = std::thread(&VideoSink::writerLoop, this);
+    }
+
+    VideoSink(const VideoSink&) = delete;
+    VideoSink& operator=(const VideoSink&) = delete;
+
+    ~VideoSink() {
+      close();
+    }
+
+    /**
+     * @brief isOpen
+     * @return true if output was opened and sink was not closed yet
+     */
+    bool isOpen() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return !closed_;
+    }
+
+    /**
+     * @brief push queues frame for writing. Blocks while queue is full.
+     * @param frame - image of sink width x height
+     * @return false if sink is closed, failed or frame has wrong size
+     */
+    bool push(std::shared_ptr<const bitmap_image> frame) {
+      if (!frame || (frame->width() != width_) || (frame->height() != height_)) {
+        std::cerr << "VideoSink::push(): Error - Frame size does not match stream size!" << std::endl;
+        return false;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_full_.wait(lock, [this] {
+        return closed_ || (queue_.size() < max_queued_);
+      });
+
+      if (closed_) return false;
+
+      queue_.push_back(std::move(frame));
+      not_empty_.notify_one();
+      return true;
+    }
+
+    /**
+     * @brief close flushes all queued frames and closes output
+     * @return false if output could not be opened or a write failed
+     */
+    bool close() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+      }
+      not_empty_.notify_all();
+      not_full_.notify_all();
+
+      if (writer_.joinable()) writer_.join();
+
+      bool good = (out_ != nullptr);
+
+      if (out_) good = out_->flush().good() && good;
+
+      if (file_.is_open()) {
+        file_.close();
+        good = !file_.fail() && good;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (!good && !failed_ && out_) {
+        std::cerr << "VideoSink::close(): Error - Could not write output!" << std::endl;
+      }
+
+      failed_ = failed_ || !good;
+
+      return !failed_;
+    }
+
+    /**
+     * @brief failed
+     * @return true if output could not be opened or a write failed
+     */
+    bool failed() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return failed_ || !out_;
+    }
+
+    /**
+     * @brief framesWritten
+     * @return number of frames already written to output
+     */
+    std::size_t framesWritten() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return frames_written_;
+    }
+
+  private:
+    void writerLoop() {
+      const std::size_t pixels = static_cast<std::size_t>(width_) * height_;
+
+      std::vector<unsigned char> buffer(3 * pixels);
+
+      for (;;) {
+        std::shared_ptr<const bitmap_image> frame;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          not_empty_.wait(lock, [this] {
+            return closed_ || !queue_.empty();
+          });
+
+          // Drain what is queued even after close()
+          if (queue_.empty()) return;
+
+          frame = std::move(queue_.front());
+          queue_.pop_front();
+        }
+        not_full_.notify_one();
+
+        if (format_ == Format::Y4M) {
+          unsigned char *y = buffer.data();
+          unsigned char *cb = y + pixels;
+          unsigned char *cr = cb + pixels;
+
+          for (unsigned int row = 0; row < height_; ++row) {
+            const std::size_t offset = static_cast<std::size_t>(row) * width_;
+            rgb_to_ycbcr(width_, frame->row(row), y + offset, cb + offset, cr + offset);
+          }
+
+          out_->write("FRAME\n", 6);
+        } else {
+          unsigned char *dst = buffer.data();
+
+          for (unsigned int row = 0; row < height_; ++row) {
+            const unsigned char *src = frame->row(row);
+
+            for (unsigned int x = 0; x < width_; ++x, src += 3, dst += 3) {
+              dst[0] = src[2];
+              dst[1] = src[1];
+              dst[2] = src[0];
+            }
+          }
+        }
+
+        out_->write(reinterpret_cast<const char *>(buffer.data()),
+                    static_cast<std::streamsize>(buffer.size()));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!out_->good()) {
+          std::cerr << "VideoSink::writerLoop(): Error - Could not write frame "
+                    << frames_written_ << "!" << std::endl;
+          // Producer gets false from push() instead of waiting for a dead writer
+          failed_ = true;
+          closed_ = true;
+          queue_.clear();
+          not_full_.notify_all();
+          return;
+        }
+
+        ++frames_written_;
+      }
+    }
+
+    unsigned int width_,
+                 height_,
+                 fps_;
+    Format format_;
+    std::size_t max_queued_;
+
+    std::ofstream file_;
+    std::ostream *out_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_,
+                            not_full_;
+    std::deque<std::shared_ptr<const bitmap_image> > queue_;
+    bool closed_,
+         failed_;
+    std::size_t frames_written_;
+
+    std::thread writer_;
+};
+
+#endif // VIDEO_SINK_H
@@ -1,10 +1,14 @@
 #include "fractalgraphicsview.h"
 #include <QWheelEvent>
 #include <QTimeLine>
+#include <QPainter>
+#include <cmath>
+#include <bitmap_image.hpp>
 
 
 FractalGraphicsView::FractalGraphicsView(QWidget *parent)
   : FractalGraphicsView::QGraphicsView(parent),
+  heatmapScale_(1),
   numScheduledScalings_(0),
   zoomAnimationTime_(250) {
 }
@@ -13,6 +17,68 @@ void FractalGraphicsView::setZoomAnimationTime(int duration_ms) {
   if (duration_ms > 0) zoomAnimationTime_ = duration_ms;
 }
 
+void FractalGraphicsView::setHeatmap(std::shared_ptr<const RenderProfile> profile, HeatmapMode mode) {
+  heatmap_ = QImage();
+  heatmapScale_ = 1;
+
+  if (profile && (mode != HeatmapOff) && (profile->width > 0) && (profile->height > 0)) {
+    const RenderProfile& p = *profile;
+
+    if (mode == HeatmapIterations) {
+      heatmap_ = QImage(static_cast<int>(p.width), static_cast<int>(p.height), QImage::Format_RGB32);
+
+      // Interior pixels ran max_iterations, so they are the hottest
+      const double scale = 999.0 / std::log1p(static_cast<double>(std::max(1U, p.max_iterations)));
+
+      for (unsigned int y = 0; y < p.height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(heatmap_.scanLine(static_cast<int>(y)));
+        const unsigned int *it = &p.iterations[static_cast<std::size_t>(y) * p.width];
+
+        for (unsigned int x = 0; x < p.width; ++x) {
+          const double executed = (it[x] == std::numeric_limits<unsigned int>::max())
+                                  ? p.max_iterations : it[x] + 1.0;
+          const rgb_t color = hot_colormap[std::min(999U, static_cast<unsigned int>(std::log1p(executed) * scale))];
+
+          line[x] = qRgb(color.red, color.green, color.blue);
+        }
+      }
+    } else {
+      // One overlay pixel per tile, scaled up when drawn
+      heatmap_ = QImage(static_cast<int>(p.tileColumns()), static_cast<int>(p.tileRows()), QImage::Format_RGB32);
+      heatmapScale_ = p.tile_size;
+
+      const double max_ns = static_cast<double>(std::max<std::int64_t>(1, p.maxTileNs()));
+      const double max_thread = std::max<std::size_t>(2, p.thread_busy_ns.size()) - 1.0;
+
+      for (std::size_t t = 0; t < p.tile_ns.size(); ++t) {
+        const double value = (mode == HeatmapTileTime) ? p.tile_ns[t] / max_ns : p.tile_thread[t] / max_thread;
+        const rgb_t color = hot_colormap[std::min(999U, static_cast<unsigned int>(value * 999.0))];
+
+        heatmap_.setPixel(static_cast<int>(t % p.tileColumns()), static_cast<int>(t / p.tileColumns()),
+                          qRgb(color.red, color.green, color.blue));
+      }
+    }
+  }
+
+  viewport()->update();
+}
+
+void FractalGraphicsView::drawForeground(QPainter *painter, const QRectF& rect) {
+  Q_UNUSED(rect)
+
+  if (heatmap_.isNull() || !scene()) return;
+
+  // Edge tiles may be partial, so the tile grid can overhang the image
+  const QRectF target(sceneRect().topLeft(),
+                      QSizeF(heatmap_.width() * heatmapScale_, heatmap_.height() * heatmapScale_));
+
+  painter->save();
+  painter->setClipRect(sceneRect());
+  painter->setOpacity(0.6);
+  painter->drawImage(target, heatmap_);
+  painter->restore();
+}
+
 void FractalGraphicsView::wheelEvent(QWheelEvent *event) {
   int numDegrees = event->delta() / 8;
   int numSteps = numDegrees / 15;
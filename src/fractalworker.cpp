@@ -1,18 +1,30 @@
 #include "fractalworker.h"
-#include <QElapsedTimer>
 
 FractalWorker::FractalWorker(JuliaSetGenerator *generator, QObject *parent) : QThread(parent) {
   generator_ = generator;
   lastDuration_ = 0;
+  config_ = generator_->getConfig();
+  queueTimer_.start();
 }
 
 void FractalWorker::run() {
+  RenderTrace::global().setThreadName("FractalWorker");
+  RenderTraceScope trace("generate", "frame");
   QElapsedTimer timer;
 
+  stats_ = RenderStats();
+  stats_.queue_wait_ns = queueTimer_.nsecsElapsed();
+  kernelName_ = generator_->kernelName(config_);
+  coloringName_ = generator_->coloringName();
+
   timer.start();
-  std::unique_ptr<bitmap_image> fractal = generator_->generate();
+  // Profile needs per-tile costs, only a real render has them
+  std::unique_ptr<bitmap_image> fractal = (cache_ && !profile_ && IterationCache::accepts(config_))
+                                          ? cache_->render(*generator_, config_, &stats_)
+                                          : generator_->generate(config_, &stats_, profile_.get());
 
-  lastDuration_ = timer.elapsed();
+  lastDuration_ = timer.nsecsElapsed();
+  stats_.generate_ns = lastDuration_;
   std::shared_ptr<bitmap_image> shared = std::move(fractal);
   emit fractalReady(shared);
 }
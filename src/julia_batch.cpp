@@ -0,0 +1,556 @@
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <julia_set_generator.h>
+#include <video_sink.h>
+#include <tile_pyramid_exporter.h>
+#include <image_encoder.h>
+#include <flight_recorder.h>
+#include <render_farm.h>
+#include <render_daemon.h>
+#include <iteration_cache.h>
+
+namespace {
+struct BatchOptions {
+  unsigned int width = JuliaSetGeneratorConfig::DEFAULT_WIDTH,
+               height = JuliaSetGeneratorConfig::DEFAULT_HEIGHT,
+               max_iterations = JuliaSetGeneratorConfig::DEFAULT_MAX_INTERATIONS,
+               frames = 1,
+               fps = 30,
+               strip_rows = 64,
+               tile_size = 256,
+               threads = 0,
+               farm_workers = 0,
+               farm_tile = RenderFarm::DEFAULT_TILE_SIZE,
+               daemon_cache_mb = 256,
+               cache_mb = 1024;
+  int farm_worker_fd = -1;
+  double c_realis = JuliaSetGeneratorConfig::DEFAULT_CONST_REALIS,
+         c_imaginalis = JuliaSetGeneratorConfig::DEFAULT_CONST_IMAGINALIS,
+         zoom = 1.0,
+         zoom_end = 1.0,
+         off_x = 0.0,
+         off_y = 0.0,
+         scale = 0.0,
+         slow_frame_ms = 0.0,
+         slow_frame_factor = 0.0;
+  std::string format = "y4m",
+              tile_format = "bmp",
+              bmp_writer = "strip",
+              output = "-",
+              trace,
+              slow_frame_dir,
+              kernel = "auto",
+              coloring = "linear",
+              farm_hosts,
+              farm_listen,
+              daemon,
+              daemon_listen,
+              cache_dir,
+              executable;
+};
+
+void printUsage(const char *name) {
+  std::cerr << "Usage: " << name << " [options]\n"
+            << "  --width N          frame width in pixels\n"
+            << "  --height N         frame height in pixels\n"
+            << "  --iterations N     max iterations per pixel\n"
+            << "  --cr X             real part of constant c\n"
+            << "  --ci X             imaginary part of constant c\n"
+            << "  --zoom X           zoom of first frame\n"
+            << "  --zoom-end X       zoom of last frame (geometric interpolation)\n"
+            << "  --offset-x X       view offset X\n"
+            << "  --offset-y X       view offset Y\n"
+            << "  --scale X          complex plane scale (1 / zoom), exact replay of\n"
+            << "                     a generator config, overrides --zoom/--zoom-end\n"
+            << "  --threads N        render threads, 0 for one per hardware thread\n"
+            << "  --kernel auto|scalar_double|double_double|fixed64|fixed128\n"
+            << "                     escape-time arithmetic, auto switches to double-double\n"
+            << "                     when pixel spacing is below double resolution, fixed64/128\n"
+            << "                     are bit-exact integer kernels for regression images\n"
+            << "                     (double for views beyond their +-128 range)\n"
+            << "  --coloring linear|equalized\n"
+            << "                     iterations to colour mapping, equalized spreads the\n"
+            << "                     palette by histogram of escape iterations\n"
+            << "  --frames N         number of frames to render\n"
+            << "  --fps N            frame rate stored in stream header\n"
+            << "  --format y4m|rgb|bmp|png|qoi|dzi|xyz|jit\n"
+            << "                     output format, bmp renders a single still image\n"
+            << "                     strip by strip straight to disk (any size),\n"
+            << "                     png/qoi encode a still image in parallel strips,\n"
+            << "                     dzi/xyz export still as deep-zoom tile pyramid\n"
+            << "                     (output is DZI name without extension / XYZ directory),\n"
+            << "                     jit exports escape iterations of a still as compressed\n"
+            << "                     tiled iteration file (any size, tile by tile access)\n"
+            << "  --bmp-writer strip|mmap\n"
+            << "                     bmp mode writer: strips through a stream or\n"
+            << "                     rendering directly into memory-mapped file\n"
+            << "  --strip-rows N     rows rendered at once in bmp strip mode\n"
+            << "  --tile-size N      tile edge in dzi/xyz/jit mode\n"
+            << "  --tile-format bmp|png|qoi\n"
+            << "                     tile image format in dzi/xyz mode\n"
+            << "  --output PATH      output file, \"-\" for stdout\n"
+            << "  --trace FILE       write Chrome trace_event JSON timeline of the run\n"
+            << "  --slow-frame-ms X  dump frames rendered slower than X ms\n"
+            << "  --slow-frame-factor X\n"
+            << "                     dump frames slower than X times the median frame\n"
+            << "  --slow-frame-dir DIR\n"
+            << "                     directory of slow frame dumps (default: current)\n"
+            << "  --farm-workers N   render bmp/png/qoi still on N local worker processes\n"
+            << "                     (tiles written into shared memory)\n"
+            << "  --farm-hosts H:P,...\n"
+            << "                     also render on remote workers started with --farm-listen\n"
+            << "  --farm-tile N      tile edge handed to farm workers\n"
+            << "  --farm-listen [HOST:]PORT\n"
+            << "                     run as remote farm worker (HOST defaults to 127.0.0.1,\n"
+            << "                     no authentication - do not expose to untrusted networks)\n"
+            << "  --daemon SOCKET    render bmp/png/qoi still through a render daemon\n"
+            << "  --daemon-listen SOCKET\n"
+            << "                     run as render daemon on a Unix domain socket, all\n"
+            << "                     clients share one thread pool and tile cache\n"
+            << "  --daemon-cache-mb N\n"
+            << "                     tile cache size of the daemon\n"
+            << "  --cache-dir DIR    reuse escape iterations of frames rendered before\n"
+            << "                     (persistent, shared with other processes)\n"
+            << "  --cache-mb N       size limit of the iteration cache\n"
+            << "  --config FILE      read options from file (slow frame dumps), '#' starts\n"
+            << "                     a comment line, later options override earlier ones\n";
+}
+
+/**
+ * @brief readConfig appends whitespace separated options of file to args,
+ * lines starting with '#' are skipped
+ */
+bool readConfig(const std::string& file_name, std::vector<std::string>& args) {
+  std::ifstream stream(file_name.c_str());
+
+  if (!stream) {
+    std::cerr << "Could not open config " << file_name << std::endl;
+    return false;
+  }
+
+  std::string line;
+
+  while (std::getline(stream, line)) {
+    const std::size_t start = line.find_first_not_of(" \t\r");
+
+    if ((start == std::string::npos) || (line[start] == '#')) continue;
+
+    std::istringstream tokens(line);
+    std::string token;
+
+    while (tokens >> token) args.push_back(token);
+  }
+
+  return true;
+}
+
+bool parseOptions(std::vector<std::string> args, BatchOptions& opt) {
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const std::string key = args[i];
+
+    if ((key == "--help") || (key == "-h")) return false;
+
+    if (i + 1 >= args.size()) {
+      std::cerr << "Missing value for " << key << std::endl;
+      return false;
+    }
+
+    const std::string value_text = args[++i];
+    const char *value = value_text.c_str();
+
+    if (key == "--config") {
+      std::vector<std::string> file_args;
+
+      if (!readConfig(value_text, file_args)) return false;
+
+      args.insert(args.begin() + static_cast<std::ptrdiff_t>(i) + 1, file_args.begin(), file_args.end());
+    }
+    else if (key == "--width") opt.width = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--height") opt.height = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--iterations") opt.max_iterations = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--cr") opt.c_realis = std::strtod(value, nullptr);
+    else if (key == "--ci") opt.c_imaginalis = std::strtod(value, nullptr);
+    else if (key == "--zoom") opt.zoom_end = opt.zoom = std::strtod(value, nullptr);
+    else if (key == "--zoom-end") opt.zoom_end = std::strtod(value, nullptr);
+    else if (key == "--offset-x") opt.off_x = std::strtod(value, nullptr);
+    else if (key == "--offset-y") opt.off_y = std::strtod(value, nullptr);
+    else if (key == "--scale") opt.scale = std::strtod(value, nullptr);
+    else if (key == "--kernel") opt.kernel = value;
+    else if (key == "--coloring") opt.coloring = value;
+    else if (key == "--threads") opt.threads = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--slow-frame-ms") opt.slow_frame_ms = std::strtod(value, nullptr);
+    else if (key == "--slow-frame-factor") opt.slow_frame_factor = std::strtod(value, nullptr);
+    else if (key == "--slow-frame-dir") opt.slow_frame_dir = value;
+    else if (key == "--frames") opt.frames = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--fps") opt.fps = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--strip-rows") opt.strip_rows = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--tile-size") opt.tile_size = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--tile-format") opt.tile_format = value;
+    else if (key == "--bmp-writer") opt.bmp_writer = value;
+    else if (key == "--format") opt.format = value;
+    else if (key == "--output") opt.output = value;
+    else if (key == "--trace") opt.trace = value;
+    else if (key == "--farm-workers") opt.farm_workers = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--farm-hosts") opt.farm_hosts = value;
+    else if (key == "--farm-tile") opt.farm_tile = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--farm-listen") opt.farm_listen = value;
+    else if (key == "--daemon") opt.daemon = value;
+    else if (key == "--daemon-listen") opt.daemon_listen = value;
+    else if (key == "--daemon-cache-mb") opt.daemon_cache_mb = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--cache-dir") opt.cache_dir = value;
+    else if (key == "--cache-mb") opt.cache_mb = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    else if (key == "--farm-worker-fd") opt.farm_worker_fd = static_cast<int>(std::strtol(value, nullptr, 10));
+    else {
+      std::cerr << "Unknown option " << key << std::endl;
+      return false;
+    }
+  }
+
+  if ((opt.width == 0) || (opt.height == 0) || (opt.frames == 0) ||
+      (opt.zoom <= 0.0) || (opt.zoom_end <= 0.0) || (opt.scale < 0.0)) {
+    std::cerr << "Invalid options" << std::endl;
+    return false;
+  }
+
+  ImageEncoder::Format image_format;
+
+  const bool encoded = (opt.format == "png") || (opt.format == "qoi");
+  const bool still = encoded || (opt.format == "bmp") || (opt.format == "dzi") || (opt.format == "xyz") ||
+                     (opt.format == "jit");
+
+  if ((encoded && !ImageEncoder::formatFromName(opt.format, image_format)) ||
+      !ImageEncoder::formatFromName(opt.tile_format, image_format)) {
+    std::cerr << "Image format not available in this build" << std::endl;
+    return false;
+  }
+
+  if (!still && (opt.format != "y4m") && (opt.format != "rgb")) {
+    std::cerr << "Unknown format " << opt.format << std::endl;
+    return false;
+  }
+
+  if (still && ((opt.output == "-") || (opt.frames != 1))) {
+    std::cerr << opt.format << " format needs an output file and a single frame" << std::endl;
+    return false;
+  }
+
+  JuliaSetGenerator::Kernel kernel;
+
+  if (!JuliaSetGenerator::kernelFromName(opt.kernel, kernel)) {
+    std::cerr << "Unknown kernel " << opt.kernel << std::endl;
+    return false;
+  }
+
+  JuliaSetGenerator::Coloring coloring;
+
+  if (!JuliaSetGenerator::coloringFromName(opt.coloring, coloring)) {
+    std::cerr << "Unknown coloring " << opt.coloring << std::endl;
+    return false;
+  }
+
+  if ((opt.bmp_writer != "strip") && (opt.bmp_writer != "mmap")) {
+    std::cerr << "Unknown bmp writer " << opt.bmp_writer << std::endl;
+    return false;
+  }
+
+  if (((opt.farm_workers > 0) || !opt.farm_hosts.empty() || !opt.daemon.empty()) &&
+      (opt.format != "bmp") && (opt.format != "png") && (opt.format != "qoi")) {
+    std::cerr << "Render farm and daemon support bmp, png and qoi formats only" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief generateFrame renders frame in memory (iterations through cache
+ * if not null), feeds slow frame recorder
+ */
+std::unique_ptr<bitmap_image> generateFrame(JuliaSetGenerator& gen, FlightRecorder& recorder, IterationCache *cache) {
+  RenderStats stats;
+  const auto start = std::chrono::steady_clock::now();
+
+  std::unique_ptr<bitmap_image> frame = (cache && IterationCache::accepts(gen.getConfig()))
+                                        ? cache->render(gen, gen.getConfig(), &stats)
+                                        : gen.generate(&stats);
+
+  stats.generate_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  recorder.record(gen.getConfig(), gen.kernelName(), gen.coloringName(), gen.threadCount(), stats);
+
+  return frame;
+}
+
+/**
+ * @brief renderFarm renders still on farm workers, colourizes and saves
+ * it here
+ */
+int renderFarm(const BatchOptions& opt, JuliaSetGenerator& gen, FlightRecorder& recorder) {
+#ifndef _WIN32
+  RenderFarm farm;
+
+  farm.setTileSize(opt.farm_tile);
+
+  if (opt.farm_workers > 0) {
+    // Local workers share the machine
+    const unsigned int threads = std::max(1U, gen.threadCount() / opt.farm_workers);
+
+    if (!farm.addLocalWorkers(opt.farm_workers, opt.executable,
+                              { "--threads", std::to_string(threads), "--kernel", opt.kernel })) return 1;
+  }
+
+  std::istringstream hosts(opt.farm_hosts);
+  std::string host;
+
+  while (std::getline(hosts, host, ',')) {
+    if (!host.empty() && !farm.addRemoteWorker(host)) return 1;
+  }
+
+  RenderStats stats;
+  const auto start = std::chrono::steady_clock::now();
+  const unsigned int *iterations = farm.render(gen, &stats);
+
+  if (!iterations) return 1;
+
+  const JuliaSetGeneratorConfig& cfg = gen.getConfig();
+
+  if (opt.format == "bmp") {
+    MappedBitmapImage image(opt.output, cfg.width_, cfg.height_);
+
+    if (!image) return 1;
+
+    gen.colorizeIterations(iterations, image);
+    image.flush();
+  } else {
+    ImageEncoder::Format format;
+    ImageEncoder::formatFromName(opt.format, format);
+
+    bitmap_image image(cfg.width_, cfg.height_);
+
+    gen.colorizeIterations(iterations, image);
+
+    if (!ImageEncoder().save(image, opt.output, format)) return 1;
+  }
+
+  stats.generate_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  recorder.record(cfg, gen.kernelName(cfg), gen.coloringName(), gen.threadCount(), stats);
+
+  return 0;
+#else
+  (void)gen;
+  (void)recorder;
+  std::cerr << "Render farm is not supported on this platform" << std::endl;
+  return 1;
+#endif
+}
+
+/**
+ * @brief renderDaemon renders still through a render daemon, bmp comes
+ * colourized from the daemon, png/qoi are colourized here
+ */
+int renderDaemon(const BatchOptions& opt, JuliaSetGenerator& gen, FlightRecorder& recorder) {
+#ifndef _WIN32
+  RenderDaemonClient client;
+
+  if (!client.connect(opt.daemon)) return 1;
+
+  const JuliaSetGeneratorConfig& cfg = gen.getConfig();
+  std::vector<unsigned int> iterations;
+  std::vector<unsigned char> bmp;
+  RenderStats stats;
+  const auto start = std::chrono::steady_clock::now();
+
+  if (!client.render(cfg, gen.kernelName(), opt.coloring, iterations, opt.format == "bmp" ? &bmp : nullptr, &stats)) return 1;
+
+  if (opt.format == "bmp") {
+    std::ofstream stream(opt.output.c_str(), std::ios::binary);
+
+    if (!stream.write(reinterpret_cast<const char *>(bmp.data()), static_cast<std::streamsize>(bmp.size()))) {
+      std::cerr << "Could not write " << opt.output << std::endl;
+      return 1;
+    }
+  } else {
+    ImageEncoder::Format format;
+    ImageEncoder::formatFromName(opt.format, format);
+
+    bitmap_image image(cfg.width_, cfg.height_);
+
+    gen.colorizeIterations(iterations.data(), image);
+
+    if (!ImageEncoder().save(image, opt.output, format)) return 1;
+  }
+
+  stats.generate_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  recorder.record(cfg, gen.kernelName(cfg), gen.coloringName(), gen.threadCount(), stats);
+
+  return 0;
+#else
+  (void)gen;
+  (void)recorder;
+  std::cerr << "Render daemon is not supported on this platform" << std::endl;
+  return 1;
+#endif
+}
+
+int render(const BatchOptions& opt) {
+  JuliaSetGenerator gen(opt.width, opt.height, opt.c_realis, opt.c_imaginalis, opt.max_iterations);
+  FlightRecorder recorder;
+
+  // Generator works with plane scale, options with zoom
+  auto planeScale = [&opt](double zoom) {
+                      return opt.scale > 0.0 ? opt.scale : 1.0 / zoom;
+                    };
+
+  JuliaSetGenerator::Kernel kernel = JuliaSetGenerator::Kernel::Auto;
+  JuliaSetGenerator::Coloring coloring = JuliaSetGenerator::Coloring::Linear;
+
+  JuliaSetGenerator::kernelFromName(opt.kernel, kernel);
+  JuliaSetGenerator::coloringFromName(opt.coloring, coloring);
+  gen.setOffsetX(opt.off_x).setOffsetY(opt.off_y).setKernel(kernel).setColoring(coloring);
+
+  if (opt.threads > 0) gen.setRenderPool(std::make_shared<RenderPool>(opt.threads));
+
+  recorder.setThreshold(static_cast<std::int64_t>(opt.slow_frame_ms * 1e6), opt.slow_frame_factor);
+  recorder.setDumpDirectory(opt.slow_frame_dir);
+
+#ifndef _WIN32
+
+  if (opt.farm_worker_fd >= 0) return RenderFarmWorker(gen.renderPool()).serve(opt.farm_worker_fd, true) ? 0 : 1;
+
+  if (!opt.farm_listen.empty()) return RenderFarmWorker(gen.renderPool()).listen(opt.farm_listen) ? 0 : 1;
+
+  if (!opt.daemon_listen.empty()) {
+    return RenderDaemon(gen.renderPool(), static_cast<std::size_t>(opt.daemon_cache_mb) << 20).listen(opt.daemon_listen) ? 0 : 1;
+  }
+
+#endif
+
+  if (!opt.daemon.empty()) return renderDaemon(opt, gen.setZoom(planeScale(opt.zoom)), recorder);
+
+  if ((opt.farm_workers > 0) || !opt.farm_hosts.empty()) return renderFarm(opt, gen.setZoom(planeScale(opt.zoom)), recorder);
+
+  std::unique_ptr<IterationCache> cache;
+
+  if (!opt.cache_dir.empty()) cache.reset(new IterationCache(opt.cache_dir, static_cast<std::uint64_t>(opt.cache_mb) << 20));
+
+  if (opt.format == "bmp") {
+    gen.setZoom(planeScale(opt.zoom));
+
+    if (cache && IterationCache::accepts(gen.getConfig())) {
+      std::vector<unsigned int> iterations;
+      MappedBitmapImage image(opt.output, opt.width, opt.height);
+
+      if (!image) return 1;
+
+      cache->iterations(gen, gen.getConfig(), iterations);
+      gen.colorizeIterations(iterations.data(), image);
+      image.flush();
+
+      return 0;
+    }
+
+    if (opt.bmp_writer == "mmap") return gen.generateToMappedFile(opt.output) ? 0 : 1;
+
+    return gen.generateToFile(opt.output, opt.strip_rows) ? 0 : 1;
+  }
+
+  if ((opt.format == "png") || (opt.format == "qoi")) {
+    ImageEncoder::Format format;
+    ImageEncoder::formatFromName(opt.format, format);
+
+    return ImageEncoder().save(*generateFrame(gen.setZoom(planeScale(opt.zoom)), recorder, cache.get()), opt.output, format) ? 0 : 1;
+  }
+
+  if (opt.format == "jit") {
+    gen.setZoom(planeScale(opt.zoom));
+
+    TiledIterationWriter writer(opt.output, opt.width, opt.height, opt.tile_size);
+
+    if (!writer) return 1;
+
+    // One band of tiles in memory, encoded in parallel
+    std::vector<unsigned int> band(static_cast<std::size_t>(opt.width) * writer.bandRows());
+
+    for (unsigned int rows = writer.bandRows(); rows > 0; rows = writer.bandRows()) {
+      gen.computeIterations(0, writer.bandTop(), opt.width, rows, band.data(), opt.width);
+
+      if (!writer.writeBand(band.data(), gen.renderPool().get())) return 1;
+    }
+
+    return writer.close() ? 0 : 1;
+  }
+
+  if ((opt.format == "dzi") || (opt.format == "xyz")) {
+    ImageEncoder::Format tile_format;
+    ImageEncoder::formatFromName(opt.tile_format, tile_format);
+
+    TilePyramidExporter exporter(gen.setZoom(planeScale(opt.zoom)), opt.tile_size,
+                                 opt.format == "dzi" ? TilePyramidExporter::Layout::DZI
+                                                     : TilePyramidExporter::Layout::XYZ,
+                                 tile_format);
+
+    return exporter.exportTo(opt.output) ? 0 : 1;
+  }
+
+  VideoSink sink(opt.output, opt.width, opt.height, opt.fps,
+                 opt.format == "y4m" ? VideoSink::Format::Y4M : VideoSink::Format::RawRGB);
+
+  if (!sink.isOpen()) return 1;
+
+  // Zoom is interpolated geometrically so that the animation speed is constant
+  const double zoom_step = (opt.frames > 1)
+                           ? std::pow(opt.zoom_end / opt.zoom, 1.0 / (opt.frames - 1))
+                           : 1.0;
+  double zoom = opt.zoom;
+
+  for (unsigned int i = 0; i < opt.frames; ++i, zoom *= zoom_step) {
+    // push() blocks while the writer is behind
+    RenderTraceScope frame_trace("frame", "frame", "frame", i);
+
+    if (!sink.push(generateFrame(gen.setZoom(planeScale(zoom)), recorder, cache.get()))) return 1;
+  }
+
+  return sink.close() ? 0 : 1;
+}
+}
+
+int main(int argc, char *argv[]) {
+  BatchOptions opt;
+
+  opt.executable = argv[0];
+#ifndef _WIN32
+  char executable[4096];
+  const ssize_t length = ::readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+
+  // Farm workers are started from the same binary, even if argv[0] is not a path
+  if (length > 0) opt.executable.assign(executable, static_cast<std::size_t>(length));
+
+  // A closed output pipe is a write error of the video sink, not a signal
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (!parseOptions(std::vector<std::string>(argv + 1, argv + argc), opt)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  RenderTrace::global().setThreadName("main");
+  RenderTrace::global().setEnabled(!opt.trace.empty());
+
+  const int result = render(opt);
+
+  if (!opt.trace.empty() && !RenderTrace::global().writeJson(opt.trace)) return 1;
+
+  return result;
+}
@@ -0,0 +1,328 @@
+#include <chrono>
+#include <complex>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <julia_set_generator.h>
+#include <image_encoder.h>
+
+namespace {
+/**
+ * @brief Escape-time kernel under test, computes one image row
+ * @return number of iterations executed
+ */
+struct BenchKernel {
+  const char *name;
+  std::uint64_t (*compute)(const double *coord_real, double coord_imag, unsigned int columns,
+                           unsigned int *iterations, const JuliaSetGenerator::InteriorTrap& trap,
+                           const JuliaSetGeneratorConfig& cfg);
+  bool cycle_detection; //!< kernel gets interiorTrap() of the view, no trap otherwise
+};
+
+/**
+ * @brief pixelRow row of a per-pixel kernel of JuliaSetGenerator
+ */
+template <typename Real>
+std::uint64_t pixelRow(const double *coord_real, double coord_imag, unsigned int columns, unsigned int *iterations,
+                       const JuliaSetGenerator::InteriorTrap&, const JuliaSetGeneratorConfig& cfg) {
+  std::uint64_t executed = 0;
+
+  for (unsigned int x = 0; x < columns; ++x) {
+    iterations[x] = JuliaSetGenerator::computeCoordinateIterations(Real(coord_real[x]), Real(coord_imag), cfg);
+    // Escaped pixel at i ran i + 1 iterations, interior ran all of them
+    executed += (iterations[x] == std::numeric_limits<unsigned int>::max()) ? cfg.max_iterations_ : iterations[x] + 1ULL;
+  }
+
+  return executed;
+}
+
+std::uint64_t scalarDoubleRow(const double *coord_real, double coord_imag, unsigned int columns, unsigned int *iterations,
+                              const JuliaSetGenerator::InteriorTrap& trap, const JuliaSetGeneratorConfig& cfg) {
+  std::uint64_t executed = 0;
+
+  for (unsigned int x = 0; x < columns; ++x) {
+    double z_real = coord_real[x],
+           z_imag = coord_imag;
+    unsigned int i = 0;
+
+    iterations[x] = JuliaSetGenerator::resumeCoordinateIterations(z_real, z_imag, i, trap, cfg);
+    executed += i;
+  }
+
+  return executed;
+}
+
+const BenchKernel kernels[] = {
+  { "scalar_double",       &scalarDoubleRow,                          false },
+  { "scalar_double_cycle", &scalarDoubleRow,                          true },
+  // BATCH_LANES pixels side by side, vectorized by the compiler
+  { "lanes_double",        &JuliaSetGenerator::computeLaneIterations, false },
+  { "lanes_double_cycle",  &JuliaSetGenerator::computeLaneIterations, true },
+  { "double_double",       &pixelRow<DoubleDouble>,                   false },
+  { "fixed64",             &pixelRow<FixedPoint64>,                   false },
+  { "fixed128",            &pixelRow<FixedPoint128>,                  false },
+};
+
+/**
+ * @brief Fixed corpus of representative views
+ */
+struct BenchView {
+  const char *name;
+  double c_realis,
+         c_imaginalis,
+         zoom,
+         off_x,
+         off_y;
+  unsigned int max_iterations;
+};
+
+const BenchView views[] = {
+  // c inside main cardioid, most pixels run to max_iterations
+  { "interior_heavy", -0.4,     0.1,      0.6,   0.0,       0.0,      1000 },
+  // default GUI view, long escape times along the filaments
+  { "boundary_heavy", -0.7,     0.27015,  0.6,   0.0,       0.0,      1000 },
+  // Cantor dust, nearly every pixel escapes within a few iterations
+  { "exterior",       0.5,      0.5,      1.0,   0.0,       0.0,      1000 },
+  // close to the limit of double precision
+  { "deep_zoom",      -0.7,     0.27015,  1e-11, 0.3129475, 0.0237775, 5000 },
+};
+
+struct BenchResult {
+  std::string view,
+              stage,
+              variant;
+  unsigned int width,
+               height;
+  double seconds,
+         iterations;
+};
+
+/**
+ * @brief best of repeats wall time in seconds
+ */
+double timeBest(unsigned int repeats, const std::function<void()>& fn) {
+  double best = 0.0;
+
+  for (unsigned int i = 0; i < repeats; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if ((i == 0) || (elapsed < best)) best = elapsed;
+  }
+
+  return best;
+}
+
+JuliaSetGeneratorConfig makeConfig(const BenchView& view, unsigned int width, unsigned int height) {
+  JuliaSetGeneratorConfig cfg(width, height, view.c_realis, view.c_imaginalis, view.max_iterations);
+
+  cfg.zoom_ = view.zoom;
+  cfg.off_x_ = view.off_x;
+  cfg.off_y_ = view.off_y;
+
+  return cfg;
+}
+
+void printJson(const std::vector<BenchResult>& results, unsigned int threads) {
+  std::cout << std::setprecision(9)
+            << "{\n  \"benchmark\": \"julia_bench\",\n  \"threads\": " << threads
+            << ",\n  \"results\": [\n";
+
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& r = results[i];
+    const double pixels = static_cast<double>(r.width) * r.height;
+
+    std::cout << "    {\"view\": \"" << r.view << "\", \"stage\": \"" << r.stage
+              << "\", \"variant\": \"" << r.variant
+              << "\", \"width\": " << r.width << ", \"height\": " << r.height
+              << ", \"seconds\": " << r.seconds
+              << ", \"mpixels_per_s\": " << pixels / r.seconds / 1e6;
+
+    if (r.iterations > 0.0) {
+      std::cout << ", \"iterations\": " << std::setprecision(15) << r.iterations << std::setprecision(9)
+                << ", \"giterations_per_s\": " << r.iterations / r.seconds / 1e9;
+    }
+
+    std::cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  std::cout << "  ]\n}\n";
+}
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int width = 640,
+               height = 480,
+               repeats = 5;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string key = argv[i];
+    const unsigned int value = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+
+    if (key == "--width") width = value;
+    else if (key == "--height") height = value;
+    else if (key == "--repeat") repeats = value;
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--width N] [--height N] [--repeat N]" << std::endl;
+      return 1;
+    }
+  }
+
+  if ((width == 0) || (height == 0) || (repeats == 0)) return 1;
+
+  std::vector<BenchResult> results;
+  std::vector<unsigned int> iterations(static_cast<std::size_t>(width) * height);
+
+  for (const BenchView& view : views) {
+    const JuliaSetGeneratorConfig cfg = makeConfig(view, width, height);
+
+    // Kernels, single thread: pure per-pixel escape-time cost, with and
+    // without the interior trap of the attracting cycle
+    const JuliaSetGenerator::InteriorTrap trap = JuliaSetGenerator::interiorTrap(cfg);
+    std::vector<double> coord_real(width);
+
+    for (unsigned int x = 0; x < width; ++x) coord_real[x] = JuliaSetGenerator::getComplexPlaneRealCoordinate(x, cfg);
+
+    for (const BenchKernel& kernel : kernels) {
+      const JuliaSetGenerator::InteriorTrap kernel_trap = kernel.cycle_detection ? trap : JuliaSetGenerator::InteriorTrap();
+      std::uint64_t total_iterations = 0;
+
+      const double seconds = timeBest(repeats, [&] {
+        total_iterations = 0;
+
+        for (unsigned int y = 0; y < height; ++y) {
+          total_iterations += kernel.compute(coord_real.data(), JuliaSetGenerator::getComplexPlaneImaginalisCoordinate(y, cfg),
+                                             width, &iterations[static_cast<std::size_t>(y) * width], kernel_trap, cfg);
+        }
+      });
+
+      results.push_back({ view.name, "kernel", kernel.name, width, height, seconds,
+                          static_cast<double>(total_iterations) });
+    }
+
+    // Colourization of the last kernel iteration buffer
+    bitmap_image image(width, height);
+
+    const double colorize_seconds = timeBest(repeats, [&] {
+      std::size_t i = 0;
+
+      for (unsigned int y = 0; y < height; ++y) {
+        unsigned char *bgr = image.row(y);
+
+        for (unsigned int x = 0; x < width; ++x, bgr += 3) {
+          const rgb_t color = JuliaSetGenerator::iterationsToColor(iterations[i++], cfg);
+
+          bgr[0] = color.blue;
+          bgr[1] = color.green;
+          bgr[2] = color.red;
+        }
+      }
+    });
+
+    results.push_back({ view.name, "colorize", "jet_colormap", width, height, colorize_seconds, 0.0 });
+
+    // Encoders
+    const double bmp_seconds = timeBest(repeats, [&] {
+      auto bmp = image.get_image();
+      (void)bmp;
+    });
+
+    results.push_back({ view.name, "encode", "bmp", width, height, bmp_seconds, 0.0 });
+
+    ImageEncoder encoder;
+
+    results.push_back({ view.name, "encode", "qoi", width, height, timeBest(repeats, [&] {
+        encoder.encodeQoi(image);
+      }), 0.0 });
+#ifdef HAVE_ZLIB
+    results.push_back({ view.name, "encode", "png", width, height, timeBest(repeats, [&] {
+        encoder.encodePng(image);
+      }), 0.0 });
+#endif
+
+    // Whole frame on the pool, tiles in image order and longest first
+    // (cost model from previous repeat), colourization pipelined with
+    // the kernel and as a separate pass
+    JuliaSetGenerator generator(width, height, view.c_realis, view.c_imaginalis, view.max_iterations);
+
+    generator.setZoom(view.zoom).setOffsetX(view.off_x).setOffsetY(view.off_y);
+
+    // Iterations are the ones the render executed (trap exits early)
+    auto timeGenerate = [&](const char *variant, const std::function<void(RenderStats&)>& render) {
+                          RenderStats stats;
+                          const double seconds = timeBest(repeats, [&] {
+                            stats = RenderStats();
+                            render(stats);
+                          });
+
+                          results.push_back({ view.name, "generate", variant, width, height, seconds,
+                                              static_cast<double>(stats.iterations) });
+                        };
+
+    timeGenerate("pool_row_major", [&](RenderStats& stats) {
+      generator.setTileSchedule(JuliaSetGenerator::TileSchedule::RowMajor).generate(&stats);
+    });
+    timeGenerate("pool_longest_first", [&](RenderStats& stats) {
+      generator.setTileSchedule(JuliaSetGenerator::TileSchedule::LongestFirst).generate(&stats);
+    });
+    timeGenerate("pool_two_pass", [&](RenderStats& stats) {
+      generator.setPipelined(false).generate(&stats);
+    });
+    generator.setPipelined(true);
+    timeGenerate("pool_longest_first_no_cycle", [&](RenderStats& stats) {
+      generator.setCycleDetection(false).generate(&stats);
+    });
+    generator.setCycleDetection(true);
+  }
+
+  // Parameter sweep: thumbnails of constants on a circle around the
+  // main cardioid, one generate() per constant and one generateBatch()
+  constexpr unsigned int THUMBNAIL_WIDTH = 128,
+                         THUMBNAIL_HEIGHT = 96,
+                         THUMBNAILS = 64;
+  std::vector<std::complex<double> > constants;
+
+  for (unsigned int i = 0; i < THUMBNAILS; ++i) {
+    constants.push_back(std::polar(0.75, 6.283185307179586 * i / THUMBNAILS));
+  }
+
+  JuliaSetGenerator thumbnail_generator(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, 0.0, 0.0, 1000);
+
+  thumbnail_generator.setZoom(0.6);
+
+  auto timeSweep = [&](const char *variant, bool cycle_detection, bool batch) {
+                     RenderStats stats;
+
+                     thumbnail_generator.setCycleDetection(cycle_detection);
+
+                     const double seconds = timeBest(repeats, [&] {
+                       stats = RenderStats();
+
+                       if (batch) {
+                         thumbnail_generator.generateBatch(constants, &stats);
+                         return;
+                       }
+
+                       for (const std::complex<double>& c : constants) {
+                         thumbnail_generator.setConstantRealis(c.real()).setConstantImaginalis(c.imag()).generate(&stats);
+                       }
+                     });
+
+                     results.push_back({ "sweep", "generate", variant, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT * THUMBNAILS,
+                                         seconds, static_cast<double>(stats.iterations) });
+                   };
+
+  timeSweep("per_constant", true, false);
+  timeSweep("batch", true, true);
+  timeSweep("per_constant_no_cycle", false, false);
+  timeSweep("batch_no_cycle", false, true);
+
+  printJson(results, RenderPool::global()->threadCount());
+
+  return 0;
+}
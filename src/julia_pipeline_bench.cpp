@@ -0,0 +1,170 @@
+#include <QApplication>
+#include <QDoubleSpinBox>
+#include <QEventLoop>
+#include <QGraphicsView>
+#include <QSpinBox>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mainwindow.h"
+
+namespace {
+struct Stage {
+  const char *name;
+  std::vector<std::int64_t> samples;
+};
+
+double percentileMs(std::vector<std::int64_t> samples, double p) {
+  if (samples.empty()) return 0.0;
+
+  std::sort(samples.begin(), samples.end());
+
+  const std::size_t index = std::min(samples.size() - 1,
+                                     static_cast<std::size_t>(p / 100.0 * (samples.size() - 1) + 0.5));
+
+  return samples[index] / 1e6;
+}
+}
+
+/*
+ * Drives MainWindow headless (Qt "offscreen" platform) and measures the
+ * latency from a parameter change to the pixmap painted in the view,
+ * broken down by stage. Prints percentiles over all runs as JSON.
+ */
+int main(int argc, char *argv[]) {
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication a(argc, argv);
+
+  qRegisterMetaType<std::shared_ptr<bitmap_image> >();
+  qRegisterMetaType<RenderStats>();
+
+  int runs = 50,
+      width = 800,
+      height = 600;
+  std::string trace_file;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string key = argv[i];
+    const int value = std::atoi(argv[i + 1]);
+
+    if (key == "--trace") trace_file = argv[i + 1];
+    else if (key == "--runs") runs = value;
+    else if (key == "--width") width = value;
+    else if (key == "--height") height = value;
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--runs N] [--width N] [--height N] [--trace FILE]" << std::endl;
+      return 1;
+    }
+  }
+
+  if ((runs <= 0) || (width <= 0) || (height <= 0)) return 1;
+
+  RenderTrace::global().setThreadName("GUI");
+  RenderTrace::global().setEnabled(!trace_file.empty());
+
+  MainWindow w;
+  // Views repeat, cached frames would skip the render being measured
+  w.setIterationCache(nullptr);
+  w.show();
+
+  QSpinBox *resolution_x = w.findChild<QSpinBox *>("spinBoxResolutionX");
+  QSpinBox *resolution_y = w.findChild<QSpinBox *>("spinBoxResolutionY");
+  QDoubleSpinBox *zoom = w.findChild<QDoubleSpinBox *>("doubleSpinBoxZoom");
+  QGraphicsView *view = w.findChild<QGraphicsView *>("graphicsView");
+
+  if (!resolution_x || !resolution_y || !zoom || !view) {
+    std::cerr << "MainWindow widgets not found" << std::endl;
+    return 1;
+  }
+
+  resolution_x->setValue(width);
+  resolution_y->setValue(height);
+
+  std::vector<Stage> stages = {
+    { "queue_wait", {} },
+    { "generate", {} },
+    { "kernel", {} },
+    { "colorize", {} },
+    { "get_image", {} },
+    { "from_data", {} },
+    { "from_image", {} },
+    { "scene_update", {} },
+    { "fit_in_view", {} },
+    { "paint", {} },
+    { "total", {} },
+  };
+
+  const double base_zoom = zoom->value();
+
+  for (int run = 0; run < runs; ++run) {
+    RenderStats stats;
+    QEventLoop loop;
+    QMetaObject::Connection connection = QObject::connect(&w, &MainWindow::frameDisplayed,
+                                                          [&](const RenderStats& s) {
+      stats = s;
+      loop.quit();
+    });
+
+    QElapsedTimer total;
+    total.start();
+
+    // Parameter change goes through the same slot as user input
+    zoom->setValue(base_zoom * (1.0 + 0.01 * (run % 10)));
+
+    if (!w.requestRender()) {
+      std::cerr << "Render already in progress" << std::endl;
+      return 1;
+    }
+
+    loop.exec();
+    QObject::disconnect(connection);
+
+    QElapsedTimer paint;
+    paint.start();
+    view->viewport()->repaint();
+    const std::int64_t paint_ns = paint.nsecsElapsed();
+
+    const std::int64_t samples[] = {
+      stats.queue_wait_ns,
+      stats.generate_ns,
+      stats.kernel_ns,
+      stats.colorize_ns,
+      stats.get_image_ns,
+      stats.from_data_ns,
+      stats.from_image_ns,
+      stats.scene_update_ns,
+      stats.fit_in_view_ns,
+      paint_ns,
+      total.nsecsElapsed()
+    };
+
+    for (std::size_t i = 0; i < stages.size(); ++i) stages[i].samples.push_back(samples[i]);
+  }
+
+  std::cout << "{\n  \"benchmark\": \"julia_pipeline_bench\",\n  \"runs\": " << runs
+            << ",\n  \"width\": " << width << ",\n  \"height\": " << height
+            << ",\n  \"stages_ms\": {\n";
+
+  for (std::size_t i = 0; i < stages.size(); ++i) {
+    const Stage& stage = stages[i];
+
+    std::cout << "    \"" << stage.name << "\": {"
+              << "\"p50\": " << percentileMs(stage.samples, 50)
+              << ", \"p90\": " << percentileMs(stage.samples, 90)
+              << ", \"p99\": " << percentileMs(stage.samples, 99)
+              << ", \"max\": " << percentileMs(stage.samples, 100)
+              << "}" << (i + 1 < stages.size() ? "," : "") << "\n";
+  }
+
+  std::cout << "  }\n}\n";
+
+  if (!trace_file.empty() && !RenderTrace::global().writeJson(trace_file)) return 1;
+
+  return 0;
+}
@@ -1,8 +1,546 @@
 #include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
 
 #include <julia_set_generator.h>
+#include <iteration_cache.h>
+#include <iteration_codec.h>
+
+namespace {
+/**
+ * @brief check prints failed behaviour check
+ * @return 1 if check failed, 0 otherwise
+ */
+int check(bool condition, const std::string& what) {
+  if (!condition) std::cerr << "julia_test: FAILED " << what << std::endl;
+
+  return condition ? 0 : 1;
+}
+
+/**
+ * @brief frameIterations computes escape iterations of the whole frame
+ * of gen with kernel
+ */
+std::vector<unsigned int> frameIterations(JuliaSetGenerator& gen, JuliaSetGenerator::Kernel kernel) {
+  const JuliaSetGeneratorConfig& cfg = gen.getConfig();
+  std::vector<unsigned int> iterations(static_cast<std::size_t>(cfg.width_) * cfg.height_);
+
+  gen.setKernel(kernel).computeIterations(0, 0, cfg.width_, cfg.height_, iterations.data(), cfg.width_);
+
+  return iterations;
+}
+
+/**
+ * @brief checkFixedPoint fixed-point kernels agree with double up to
+ * rounding of boundary pixels, and views beyond their range fall back
+ * to double instead of overflowing
+ */
+int checkFixedPoint() {
+  using Kernel = JuliaSetGenerator::Kernel;
+
+  int failures = 0;
+  JuliaSetGenerator gen(400, 300, -0.7, 0.27015, 300);
+
+  for (const double zoom : { 1.0, 2.0, 5.0, 20.0 }) {
+    gen.setZoom(zoom);
+
+    const bool fits = zoom <= 2.0;
+    const std::vector<unsigned int> reference = frameIterations(gen, Kernel::Double);
+
+    for (const Kernel kernel : { Kernel::FixedPoint64, Kernel::FixedPoint128 }) {
+      const std::string name = std::string(JuliaSetGenerator::kernelName(kernel)) + " zoom " + std::to_string(zoom);
+      const std::vector<unsigned int> iterations = frameIterations(gen, kernel);
+      std::size_t mismatches = 0;
+
+      for (std::size_t i = 0; i < iterations.size(); ++i) mismatches += iterations[i] != reference[i];
+
+      failures += check(JuliaSetGenerator::resolveKernel(kernel, gen.getConfig()) == (fits ? kernel : Kernel::Double),
+                        name + " kernel resolution");
+      failures += check(mismatches <= iterations.size() / 1000, name + " matches double (" +
+                        std::to_string(mismatches) + " pixels differ)");
+    }
+  }
+
+  return failures;
+}
+
+/**
+ * @brief checkDoubleDouble double-double agrees with double on shallow
+ * views and resolves columns where double collapses into blocks on a deep
+ * view, which Kernel::Auto renders with double-double
+ */
+int checkDoubleDouble() {
+  using Kernel = JuliaSetGenerator::Kernel;
+
+  int failures = 0;
+  // Boundary of the rabbit's interior on the real axis
+  JuliaSetGenerator gen(160, 120, -0.12, 0.75, 3000);
+
+  gen.setOffsetX(0.34491780098252262);
+
+  for (const double zoom : { 1.0, 0.3 }) {
+    gen.setZoom(zoom);
+
+    const std::string name = "double-double zoom " + std::to_string(zoom);
+    const std::vector<unsigned int> reference = frameIterations(gen, Kernel::Double);
+    const std::vector<unsigned int> iterations = frameIterations(gen, Kernel::DoubleDouble);
+    std::size_t mismatches = 0;
+
+    for (std::size_t i = 0; i < iterations.size(); ++i) mismatches += iterations[i] != reference[i];
+
+    failures += check(JuliaSetGenerator::resolveKernel(Kernel::Auto, gen.getConfig()) == Kernel::Double,
+                      name + " resolves to double");
+    failures += check(mismatches <= iterations.size() / 1000, name + " matches double (" +
+                      std::to_string(mismatches) + " pixels differ)");
+  }
+
+  // Pixel spacing of about half an ulp of the offset
+  gen.setZoom(1e-15);
+
+  const JuliaSetGeneratorConfig& cfg = gen.getConfig();
+  auto distinctColumns = [&cfg](const std::vector<unsigned int>& iterations) {
+                           std::set<std::vector<unsigned int> > columns;
+
+                           for (unsigned int x = 0; x < cfg.width_; ++x) {
+                             std::vector<unsigned int> column(cfg.height_);
+
+                             for (unsigned int y = 0; y < cfg.height_; ++y) column[y] = iterations[y * cfg.width_ + x];
+
+                             columns.insert(column);
+                           }
+
+                           return columns.size();
+                         };
+  const std::size_t collapsed = distinctColumns(frameIterations(gen, Kernel::Double)),
+                    resolved = distinctColumns(frameIterations(gen, Kernel::DoubleDouble));
+
+  failures += check(JuliaSetGenerator::resolveKernel(Kernel::Auto, cfg) == Kernel::DoubleDouble,
+                    "deep view resolves to double-double");
+  failures += check(resolved > 2 * collapsed, "double-double resolves deep view (" + std::to_string(resolved) +
+                    " distinct columns, double " + std::to_string(collapsed) + ")");
+
+  return failures;
+}
+
+/**
+ * @brief samePixels
+ * @return true if images have equal size and pixels
+ */
+bool samePixels(const bitmap_image& a, const bitmap_image& b) {
+  return (a.width() == b.width()) && (a.height() == b.height()) &&
+         std::equal(a.data(), a.data() + 3ULL * a.width() * a.height(), b.data());
+}
+
+/**
+ * @brief temporaryDirectory returns a new, not yet existing directory name
+ */
+std::string temporaryDirectory(const std::string& prefix) {
+  return (std::filesystem::temp_directory_path() / (prefix + std::to_string(std::random_device()()))).string();
+}
+
+/**
+ * @brief readFile returns bytes of file, empty if it can't be read
+ */
+std::string readFile(const std::string& file_name) {
+  std::ifstream stream(file_name.c_str(), std::ios::binary);
+
+  return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief checkEqualizedOutputs every output path of one equalized frame
+ * (whole frame, BMP strips, memory-mapped BMP) uses the same palette
+ */
+int checkEqualizedOutputs() {
+  const std::string whole_name = "julia_test_whole.bmp",
+                    strips_name = "julia_test_strips.bmp",
+                    mapped_name = "julia_test_mapped.bmp";
+
+  int failures = 0;
+  JuliaSetGenerator gen(517, 333, -0.4, 0.6, 500);
+
+  gen.setColoring(JuliaSetGenerator::Coloring::HistogramEqualized).setZoom(0.8);
+  gen.generate()->save_image(whole_name);
+
+  failures += check(gen.generateToFile(strips_name, 16), "equalized BMP strips written");
+  failures += check(gen.generateToMappedFile(mapped_name), "equalized mapped BMP written");
+
+  const std::string whole = readFile(whole_name);
+
+  failures += check(!whole.empty() && (readFile(strips_name) == whole), "equalized BMP strips match whole frame");
+  failures += check(!whole.empty() && (readFile(mapped_name) == whole), "equalized mapped BMP matches whole frame");
+
+  std::remove(whole_name.c_str());
+  std::remove(strips_name.c_str());
+  std::remove(mapped_name.c_str());
+
+  return failures;
+}
+
+/**
+ * @brief checkPipelined colourizing tile rows while the kernel pass still
+ * runs gives the same image as a separate colourization pass, for both
+ * tile schedules and colourings, whole frames and regions
+ */
+int checkPipelined() {
+  using Coloring = JuliaSetGenerator::Coloring;
+  using TileSchedule = JuliaSetGenerator::TileSchedule;
+
+  int failures = 0;
+  JuliaSetGenerator gen(517, 333, -0.12, 0.75, 500);
+
+  gen.setZoom(0.8);
+
+  for (const Coloring coloring : { Coloring::Linear, Coloring::HistogramEqualized }) {
+    gen.setColoring(coloring).setTileSchedule(TileSchedule::RowMajor).setPipelined(false);
+
+    const auto expected = gen.generate();
+    const auto expected_region = gen.generateRegion(100, 70, 300, 200);
+
+    for (const TileSchedule schedule : { TileSchedule::RowMajor, TileSchedule::LongestFirst }) {
+      for (const bool pipelined : { false, true }) {
+        const std::string name = std::string(schedule == TileSchedule::RowMajor ? "row major" : "longest first") +
+                                 (pipelined ? " pipelined " : " separate pass ") +
+                                 (coloring == Coloring::Linear ? "linear" : "equalized");
+
+        gen.setTileSchedule(schedule).setPipelined(pipelined);
+
+        // Second frame of longest first is ordered by costs of the first
+        failures += check(samePixels(*gen.generate(), *expected), name + " frame matches");
+        failures += check(samePixels(*gen.generate(), *expected), name + " repeated frame matches");
+        failures += check(samePixels(*gen.generateRegion(100, 70, 300, 200), *expected_region),
+                          name + " region matches");
+      }
+    }
+  }
+
+  return failures;
+}
+
+/**
+ * @brief checkIterationCache a miss renders the frame as generate() does,
+ * stores its iterations in the background, a hit executes no iterations,
+ * and a miss after raising max iterations resumes the previous frame
+ */
+int checkIterationCache() {
+  const std::string directory = temporaryDirectory("julia_test_cache_");
+
+  int failures = 0;
+  JuliaSetGenerator reference(320, 240, -0.8, 0.156, 200);
+  JuliaSetGenerator gen;
+  std::vector<unsigned int> iterations;
+
+  reference.setColoring(JuliaSetGenerator::Coloring::HistogramEqualized).setZoom(0.7);
+  gen.setColoring(JuliaSetGenerator::Coloring::HistogramEqualized).setResumable(true);
+  {
+    IterationCache cache(directory, 64ULL << 20);
+    JuliaSetGeneratorConfig cfg = reference.getConfig();
+    const std::string kernel = reference.kernelName();
+    RenderStats miss, hit, resumed, fresh;
+
+    const auto expected = reference.generate(&fresh);
+    const auto missed = cache.render(gen, cfg, &miss);
+
+    cache.flush();
+    failures += check(samePixels(*missed, *expected), "cache miss matches generate()");
+    failures += check(miss.iterations == fresh.iterations, "cache miss renders the whole frame");
+    failures += check(cache.load(cfg, kernel, iterations), "cache entry stored");
+
+    const auto cached = cache.render(gen, cfg, &hit);
+
+    failures += check(samePixels(*cached, *expected), "cache hit matches generate()");
+    failures += check(hit.iterations == 0, "cache hit executes no iterations");
+
+    cfg.max_iterations_ = 1000;
+    fresh = RenderStats();
+
+    const auto raised = reference.setMaxIterations(cfg.max_iterations_).generate(&fresh);
+
+    failures += check(samePixels(*cache.render(gen, cfg, &resumed), *raised), "resumed cache miss matches generate()");
+    failures += check(resumed.iterations < fresh.iterations, "cache miss resumes previous frame");
+
+    // Temporary files of crashed writers are removed once stale
+    const std::string stale = directory + "/0123456789abcdef.jit.tmp1",
+                      writing = directory + "/0123456789abcdef.jit.tmp2";
+
+    std::ofstream(stale) << "partial";
+    std::ofstream(writing) << "partial";
+    std::filesystem::last_write_time(stale, std::filesystem::file_time_type::clock::now() -
+                                            IterationCache::STALE_TEMPORARY_AGE - std::chrono::minutes(1));
+
+    cfg.max_iterations_ = 300;
+    cache.render(gen, cfg);
+    cache.flush();
+    failures += check(!std::filesystem::exists(stale), "stale temporary file removed");
+    failures += check(std::filesystem::exists(writing), "temporary file being written kept");
+  }
+
+  std::error_code error;
+  std::filesystem::remove_all(directory, error);
+
+  return failures;
+}
+
+/**
+ * @brief checkNarrowCells renders through 8, 16 and 32-bit band cells
+ * (also at the limits of each) match colourized 32-bit iterations
+ */
+int checkNarrowCells() {
+  using Coloring = JuliaSetGenerator::Coloring;
+
+  int failures = 0;
+  JuliaSetGenerator gen(160, 120, -0.7, 0.27015, 100);
+
+  gen.setZoom(0.8);
+
+  for (const unsigned int max_iterations : { 100U, 128U, 129U, 300U, 32768U, 32769U, 40000U }) {
+    gen.setMaxIterations(max_iterations);
+
+    const JuliaSetGeneratorConfig& cfg = gen.getConfig();
+    const std::string name = std::to_string(max_iterations) + " iterations (" +
+                             std::to_string(JuliaSetGenerator::iterationBytes(cfg)) + " byte cells)";
+    std::vector<unsigned int> iterations(static_cast<std::size_t>(cfg.width_) * cfg.height_),
+                              captured;
+
+    gen.computeIterations(0, 0, cfg.width_, cfg.height_, iterations.data(), cfg.width_);
+
+    for (const Coloring coloring : { Coloring::Linear, Coloring::HistogramEqualized }) {
+      bitmap_image expected(cfg.width_, cfg.height_);
+
+      gen.setColoring(coloring).colorizeIterations(iterations.data(), expected);
+
+      const std::string variant = name + (coloring == Coloring::Linear ? " linear" : " equalized");
+
+      failures += check(samePixels(*gen.generate(), expected), "narrow cells match at " + variant);
+      failures += check(samePixels(*gen.generate(cfg, captured), expected) && (captured == iterations),
+                        "captured narrow cells match at " + variant);
+    }
+  }
+
+  return failures;
+}
+
+/**
+ * @brief checkResume computeFrameIterations() after raising max iterations
+ * equals a fresh computation and only iterates the capped pixels further;
+ * any other change starts over
+ */
+int checkResume() {
+  int failures = 0;
+  JuliaSetGenerator resumed(240, 180, -0.8, 0.156, 100);
+  JuliaSetGenerator fresh(240, 180, -0.8, 0.156, 100);
+
+  resumed.setResumable(true).setZoom(0.7);
+  fresh.setZoom(0.7);
+
+  JuliaSetGeneratorConfig cfg = resumed.getConfig();
+  std::vector<unsigned int> iterations(static_cast<std::size_t>(cfg.width_) * cfg.height_),
+                            expected(iterations.size());
+
+  resumed.computeFrameIterations(cfg, iterations.data());
+
+  for (const unsigned int max_iterations : { 300U, 300U, 2000U, 5000U }) {
+    const std::uint64_t full = fresh.setMaxIterations(max_iterations).
+                               computeIterations(0, 0, cfg.width_, cfg.height_, expected.data(), cfg.width_);
+
+    cfg.max_iterations_ = max_iterations;
+
+    const std::uint64_t executed = resumed.computeFrameIterations(cfg, iterations.data());
+    const std::string name = "resume to " + std::to_string(max_iterations) + " iterations";
+
+    failures += check(iterations == expected, name + " matches fresh frame");
+    failures += check(executed < full, name + " executes fewer iterations");
+  }
+
+  // Lower max iterations and another view can't resume
+  for (const double zoom : { 0.7, 0.6 }) {
+    cfg.max_iterations_ = 1000;
+    cfg.zoom_ = zoom;
+    fresh.setMaxIterations(cfg.max_iterations_).setZoom(zoom).
+    computeIterations(0, 0, cfg.width_, cfg.height_, expected.data(), cfg.width_);
+    resumed.computeFrameIterations(cfg, iterations.data());
+    failures += check(iterations == expected, "restart at zoom " + std::to_string(zoom) + " matches fresh frame");
+  }
+
+  return failures;
+}
+
+/**
+ * @brief putLE32 overwrites 32-bit little endian field of encoded frame
+ */
+void putLE32(std::vector<unsigned char>& data, std::size_t offset, std::uint32_t value) {
+  for (unsigned int i = 0; i < 4; ++i) data[offset + i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+/**
+ * @brief checkIterationCodec .jit frames decode to the encoded iterations
+ * (whole frame and single tiles), truncated or corrupt frames are
+ * rejected without reading outside the data
+ */
+int checkIterationCodec() {
+  const unsigned int width = 301,
+                     height = 203,
+                     tile_size = 64;
+
+  int failures = 0;
+  JuliaSetGenerator gen(width, height, -0.7, 0.27015, 300);
+  std::vector<unsigned int> iterations(static_cast<std::size_t>(width) * height),
+                            decoded(iterations.size());
+
+  gen.computeIterations(0, 0, width, height, iterations.data(), width);
+
+  const std::vector<unsigned char> data = TiledIterations::encode(iterations.data(), width, height, tile_size,
+                                                                  gen.renderPool().get());
+  TiledIterations frame;
+
+  failures += check(frame.open(data.data(), data.size()) && (frame.width() == width) && (frame.height() == height),
+                    "codec frame opens");
+  failures += check(frame.decode(decoded.data(), gen.renderPool().get()) && (decoded == iterations),
+                    "codec round trip");
+
+  // Last tile is the partial bottom right one
+  std::fill(decoded.begin(), decoded.end(), 0);
+  failures += check(frame.decodeTile(frame.tileCount() - 1, decoded.data(), width) &&
+                    (decoded.back() == iterations.back()) && (decoded.front() == 0), "codec single tile");
+
+  for (const std::size_t size : { std::size_t(0), std::size_t(10), TiledIterations::FIXED_HEADER_SIZE,
+                                  std::size_t(100), data.size() / 2, data.size() - 1 }) {
+    TiledIterations truncated;
+    const bool opened = truncated.open(data.data(), size);
+
+    failures += check(!opened || !truncated.decode(decoded.data()), "codec rejects frame truncated to " +
+                      std::to_string(size) + " bytes");
+  }
+
+  // Tile counts whose offset table size overflows 64 bits
+  std::vector<unsigned char> huge = data;
+
+  putLE32(huge, 8, 0xFFFFFFFFu);
+  putLE32(huge, 12, 0xFFFFFFFFu);
+  putLE32(huge, 16, 1);
+  failures += check(!TiledIterations().open(huge.data(), huge.size()), "codec rejects oversized tile count");
+
+  // Offsets out of order
+  std::vector<unsigned char> swapped = data;
+
+  std::swap_ranges(swapped.begin() + TiledIterations::FIXED_HEADER_SIZE,
+                   swapped.begin() + TiledIterations::FIXED_HEADER_SIZE + 8,
+                   swapped.begin() + TiledIterations::FIXED_HEADER_SIZE + 8);
+  failures += check(!TiledIterations().open(swapped.data(), swapped.size()), "codec rejects decreasing offsets");
+
+  // Garbage tile data decodes to the wrong value count
+  std::vector<unsigned char> garbage = data;
+  TiledIterations corrupt;
+
+  std::fill(garbage.end() - static_cast<std::ptrdiff_t>(data.size() / 4), garbage.end(), 0xFF);
+  failures += check(corrupt.open(garbage.data(), garbage.size()) && !corrupt.decode(decoded.data()),
+                    "codec rejects corrupt tile data");
+
+  return failures;
+}
+
+/**
+ * @brief checkBatch every image of generateBatch() equals generate() with
+ * c set to its constant, for both colourings and sampled palette strides
+ */
+int checkBatch() {
+  using Coloring = JuliaSetGenerator::Coloring;
+
+  int failures = 0;
+  const std::vector<std::complex<double> > constants = { { -0.8, 0.156 }, { -0.12, 0.75 }, { 0.285, 0.01 } };
+
+  for (const unsigned int width : { 200U, 600U }) {
+    JuliaSetGenerator gen(width, width * 3 / 4, 0.0, 0.0, 300);
+
+    for (const Coloring coloring : { Coloring::Linear, Coloring::HistogramEqualized }) {
+      const std::string name = std::to_string(width) + (coloring == Coloring::Linear ? " linear" : " equalized");
+
+      gen.setColoring(coloring);
+
+      const auto single = gen.generateBatch({ constants.front() });
+      const auto batch = gen.generateBatch(constants);
+
+      for (std::size_t c = 0; c < constants.size(); ++c) {
+        JuliaSetGenerator reference = gen;
+        const auto expected = reference.setConstantRealis(constants[c].real()).
+                              setConstantImaginalis(constants[c].imag()).generate();
+
+        if (c == 0) failures += check(samePixels(*single.front(), *expected), "single constant batch matches at " + name);
+
+        failures += check(samePixels(*batch[c], *expected), "batch image " + std::to_string(c) + " matches at " + name);
+      }
+    }
+  }
+
+  return failures;
+}
+
+/**
+ * @brief checkCycleDetection trapping orbits in the attracting cycle of c
+ * changes no pixel, for cycles of period 1 to 3, a c close to the edge of
+ * the main cardioid (multiplier near 1), a c without trap, and resumed
+ * frames
+ */
+int checkCycleDetection() {
+  struct Case {
+    double c_realis,
+           c_imaginalis;
+    unsigned int period;
+  };
+
+  int failures = 0;
+
+  for (const Case& c : { Case { -0.2, 0.2, 1 }, Case { -1.0, 0.0, 2 }, Case { -0.12, 0.75, 3 },
+                         Case { -0.74, 0.05, 1 }, Case { -0.1, 0.65, 0 } }) {
+    JuliaSetGenerator trapped(240, 180, c.c_realis, c.c_imaginalis, 500);
+    JuliaSetGenerator plain(240, 180, c.c_realis, c.c_imaginalis, 500);
+
+    trapped.setZoom(0.8);
+    plain.setZoom(0.8).setCycleDetection(false);
+
+    const JuliaSetGeneratorConfig& cfg = trapped.getConfig();
+    const std::string name = "c = " + std::to_string(c.c_realis) + (c.c_imaginalis < 0 ? "" : "+") +
+                             std::to_string(c.c_imaginalis) + "i";
+    std::vector<unsigned int> trapped_iterations, plain_iterations;
+
+    failures += check(JuliaSetGenerator::interiorTrap(cfg).period == c.period,
+                      "trap of " + name + " has period " + std::to_string(c.period));
+    failures += check(samePixels(*trapped.generate(cfg, trapped_iterations), *plain.generate(cfg, plain_iterations)) &&
+                      (trapped_iterations == plain_iterations), "cycle detection keeps pixels at " + name);
+
+    // Resumed frames continue trapped orbits from their final z
+    JuliaSetGeneratorConfig deeper = cfg;
+
+    trapped.setResumable(true).generate(cfg, trapped_iterations);
+
+    for (const unsigned int max_iterations : { 2000U, 5000U }) {
+      deeper.max_iterations_ = max_iterations;
+
+      const auto resumed = trapped.generate(deeper, trapped_iterations);
+
+      failures += check(samePixels(*resumed, *plain.generate(deeper, plain_iterations)) &&
+                        (trapped_iterations == plain_iterations),
+                        "resumed cycle detection keeps pixels at " + name + ", " +
+                        std::to_string(max_iterations) + " iterations");
+    }
+  }
+
+  return failures;
+}
+}
 
 int main() {
+  const int failures = checkFixedPoint() + checkDoubleDouble() + checkEqualizedOutputs() + checkPipelined() +
+                       checkIterationCache() + checkIterationCodec() + checkNarrowCells() + checkResume() +
+                       checkBatch() + checkCycleDetection();
+
+  if (failures) return 1;
+
   const unsigned int width = 1500;
   const unsigned int height = 1000;
   const unsigned int max_iterations = 300;
@@ -1,17 +1,41 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QStringList>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QStandardPaths>
 
 
 MainWindow::MainWindow(QWidget *parent) :
   QMainWindow(parent),
   ui(new Ui::MainWindow),
-  generator_thread(nullptr) {
+  generator_thread(nullptr),
+  renderPending_(false) {
   ui->setupUi(this);
 
   ui->pushButtonGenerate->setEnabled(!ui->checkBoxAutoGenerate->isChecked());
+  ui->labelStats->setVisible(ui->groupBoxStats->isChecked());
+  RenderTrace::global().setThreadName("GUI");
+
+  recorder_.setDumpDirectory(
+    (QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/slow_frames").toStdString());
+  cache_ = std::make_shared<IterationCache>(
+    (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/iterations").toStdString(),
+    ITERATION_CACHE_BYTES);
+  on_spinBoxSlowFrameMs_valueChanged(ui->spinBoxSlowFrameMs->value());
+  on_spinBoxFrameBudgetMs_valueChanged(ui->spinBoxFrameBudgetMs->value());
+  budget_.setScaleIterations(ui->checkBoxBudgetIterations->isChecked());
+
+  refineTimer_.setSingleShot(true);
+  refineTimer_.setInterval(REFINE_DELAY_MS);
+  connect(&refineTimer_, &QTimer::timeout, this, &MainWindow::refineFrame);
   scene = new QGraphicsScene(this);
 
 
+  // Full frames go through the iteration cache, whose misses resume capped
+  // pixels of the previous full frame when only max iterations went up
+  renderGenerator_.setResumable(true);
+
   generator.
   setMaxIterations(static_cast<unsigned int>(ui->spinBoxMaxIterations->value())).
   setConstantRealis(ui->doubleSpinBoxConstRealis->value()).
@@ -26,65 +50,263 @@ MainWindow::~MainWindow() {
   delete scene;
 }
 
+bool MainWindow::requestRender() {
+  // There is no cancellation of a running frame, the new request is dropped
+  if (generator_thread) {
+    RenderTrace::global().instant("render request dropped", "cancel");
+    return false;
+  }
+
+  const bool started = startRender(budget_.frameConfig(generator.getConfig()));
+
+  // Every interactive frame postpones refinement
+  if (budget_.reduced()) refineTimer_.start();
+  else refineTimer_.stop();
+
+  return started;
+}
+
+void MainWindow::refineFrame() {
+  if (generator_thread) {
+    refineTimer_.start();
+    return;
+  }
+
+  startRender(budget_.fullConfig(generator.getConfig()));
+}
+
+bool MainWindow::startRender(const JuliaSetGeneratorConfig& cfg) {
+  RenderTrace::global().instant("render request", "frame", "width", cfg.width_);
+  requestTimer_.start();
+
+  frameFullConfig_ = generator.getConfig();
+
+  // Settings snapshot of the frame, slots keep changing generator while
+  // the worker renders. No worker is running here.
+  renderGenerator_.setKernel(generator.kernel()).setColoring(generator.coloring()).
+  setCycleDetection(generator.cycleDetection());
+
+  generator_thread = new FractalWorker(&renderGenerator_, this);
+  generator_thread->setConfig(cfg);
+
+  // Reduced interactive frames are not worth the disk space
+  if (!budget_.reduced()) generator_thread->setCache(cache_);
+
+  if (ui->comboBoxHeatmap->currentIndex() != FractalGraphicsView::HeatmapOff) {
+    generator_thread->setProfile(std::make_shared<RenderProfile>());
+  }
+
+  connect(generator_thread, &FractalWorker::fractalReady, this, &MainWindow::handleFractalResults);
+  generator_thread->start();
+
+  return true;
+}
+
 void MainWindow::handleFractalResults(std::shared_ptr<bitmap_image> fractal) {
+  RenderTraceScope handoff_trace("UI handoff", "ui");
+  RenderStats stats = generator_thread->lastStats();
+  QElapsedTimer stage;
+
+  auto traceStage = [](const char *name, qint64 ns) {
+                      const std::int64_t end = RenderTrace::now();
+
+                      RenderTrace::global().complete(name, "ui", end - ns, end);
+                    };
+
+  stage.start();
   auto raw_image = fractal->get_image();
+  stats.get_image_ns = stage.nsecsElapsed();
+  traceStage("get_image", stats.get_image_ns);
 
+  stage.start();
   image = image.fromData(raw_image.get(), static_cast<int>(fractal->get_size()));
+  stats.from_data_ns = stage.nsecsElapsed();
+  traceStage("from_data", stats.from_data_ns);
 
+  stage.start();
+  QPixmap pixmap = QPixmap::fromImage(image);
+  stats.from_image_ns = stage.nsecsElapsed();
+  traceStage("from_image", stats.from_image_ns);
+
+  stage.start();
   scene->clear();
-  scene->addPixmap(QPixmap::fromImage(image));
+  scene->addPixmap(pixmap);
   scene->setSceneRect(image.rect());
   ui->graphicsView->setScene(scene);
+  stats.scene_update_ns = stage.nsecsElapsed();
+  traceStage("scene_update", stats.scene_update_ns);
+
+  stage.start();
   ui->graphicsView->fitInView(image.rect(), Qt::KeepAspectRatio);
+  stats.fit_in_view_ns = stage.nsecsElapsed();
+  traceStage("fit_in_view", stats.fit_in_view_ns);
+
+  stats.total_ns = requestTimer_.nsecsElapsed();
+  lastStats_ = stats;
+
+  recorder_.record(generator_thread->lastConfig(), generator_thread->lastKernelName(),
+                   generator_thread->lastColoringName(), renderGenerator_.threadCount(), stats);
+  budget_.record(generator_thread->lastConfig(), frameFullConfig_, stats);
+
+  // Profile of older frame does not match the new image
+  lastProfile_ = generator_thread->profile();
+  ui->graphicsView->setHeatmap(lastProfile_,
+                               static_cast<FractalGraphicsView::HeatmapMode>(ui->comboBoxHeatmap->currentIndex()));
 
   ui->labelGenerateTime->setText(QString::number(generator_thread->lastGenerateDurationMs()));
+  updateStatsPanel(stats, lastProfile_.get());
 
+  // fractalReady is emitted at the very end of run(), let it return
+  generator_thread->wait();
   delete generator_thread;
   generator_thread = nullptr;
+
+  emit frameDisplayed(stats);
+
+  // Parameters changed while rendering, show the latest ones
+  if (renderPending_) {
+    renderPending_ = false;
+    requestRender();
+  }
+}
+
+void MainWindow::parametersChanged() {
+  if (!ui->checkBoxAutoGenerate->isChecked()) return;
+
+  if (!requestRender()) renderPending_ = true;
+}
+
+void MainWindow::updateStatsPanel(const RenderStats& stats, const RenderProfile *profile) {
+  auto ms = [](std::int64_t ns) {
+              return QString::number(ns / 1e6, 'f', 2) + " ms";
+            };
+
+  QStringList lines;
+
+  lines << "Queue wait: " + ms(stats.queue_wait_ns)
+        << "Kernel: " + ms(stats.kernel_ns)
+        << "Colourization: " + ms(stats.colorize_ns)
+        << "Encode/convert: " + ms(stats.get_image_ns + stats.from_data_ns)
+        << "UI upload: " + ms(stats.from_image_ns)
+        << "Scene update: " + ms(stats.scene_update_ns + stats.fit_in_view_ns)
+        << "Total: " + ms(stats.total_ns)
+        << "Iterations: " + QString::number(static_cast<double>(stats.iterations), 'g', 4)
+        << "Mpixel/s: " + QString::number(stats.pixelsPerSecond() / 1e6, 'f', 2)
+        << "Giter/s: " + QString::number(stats.iterationsPerSecond() / 1e9, 'f', 3);
+
+  if (budget_.enabled() && generator_thread) {
+    const JuliaSetGeneratorConfig& cfg = generator_thread->lastConfig();
+
+    lines << "Frame resolution: " + QString::number(cfg.width_) + "x" + QString::number(cfg.height_) +
+             " of " + QString::number(frameFullConfig_.width_) + "x" + QString::number(frameFullConfig_.height_)
+          << "Frame iterations: " + QString::number(cfg.max_iterations_) +
+             " of " + QString::number(frameFullConfig_.max_iterations_);
+  }
+
+  if (profile) {
+    lines << "Threads: " + QString::number(profile->thread_busy_ns.size())
+          << "Load imbalance (max/mean busy): " + QString::number(profile->threadImbalance(), 'f', 2)
+          << "Slowest tile: " + ms(profile->maxTileNs());
+  }
+
+  ui->labelStats->setText(lines.join('\n'));
+}
+
+void MainWindow::on_groupBoxStats_toggled(bool checked) {
+  ui->labelStats->setVisible(checked);
+
+  if (!checked) {
+    ui->comboBoxHeatmap->setCurrentIndex(FractalGraphicsView::HeatmapOff);
+    ui->checkBoxTrace->setChecked(false);
+  }
+}
+
+void MainWindow::on_comboBoxHeatmap_currentIndexChanged(int index) {
+  // Per-pixel data is only collected when overlay is on, re-render to get it
+  ui->graphicsView->setHeatmap(lastProfile_, static_cast<FractalGraphicsView::HeatmapMode>(index));
+}
+
+void MainWindow::on_checkBoxTrace_toggled(bool checked) {
+  if (checked) RenderTrace::global().clear();
+
+  RenderTrace::global().setEnabled(checked);
+}
+
+void MainWindow::on_pushButtonSaveTrace_clicked() {
+  const QString file_name = QFileDialog::getSaveFileName(this, "Save trace", "julia_trace.json",
+                                                         "Chrome trace (*.json)");
+
+  if (file_name.isEmpty()) return;
+
+  if (!RenderTrace::global().writeJson(file_name.toStdString())) {
+    QMessageBox::warning(this, "Save trace", "Could not write " + file_name);
+  }
+}
+
+void MainWindow::on_spinBoxSlowFrameMs_valueChanged(int arg1) {
+  recorder_.setThreshold(static_cast<std::int64_t>(arg1) * 1000000);
+}
+
+void MainWindow::on_spinBoxFrameBudgetMs_valueChanged(int arg1) {
+  budget_.setBudget(static_cast<std::int64_t>(arg1) * 1000000);
+}
+
+void MainWindow::on_checkBoxBudgetIterations_toggled(bool checked) {
+  budget_.setScaleIterations(checked);
+}
+
+void MainWindow::on_comboBoxColoring_currentIndexChanged(int index) {
+  generator.setColoring(static_cast<JuliaSetGenerator::Coloring>(index));
+  parametersChanged();
 }
 
 void MainWindow::on_checkBoxAutoGenerate_clicked(bool checked) {
   ui->pushButtonGenerate->setEnabled(!checked);
+  parametersChanged();
 }
 
 void MainWindow::on_pushButtonGenerate_clicked() {
-  if (generator_thread) return;
-
-  generator_thread = new FractalWorker(&generator, this);
-  connect(generator_thread, &FractalWorker::fractalReady, this, &MainWindow::handleFractalResults);
-  generator_thread->start();
+  requestRender();
 }
 
 void MainWindow::on_doubleSpinBoxZoom_valueChanged(double arg1) {
   generator.setZoom(1.0 / arg1);
+  parametersChanged();
 }
 
 void MainWindow::on_spinBoxResolutionX_valueChanged(int arg1) {
   generator.setWidth(static_cast<unsigned int>(arg1));
+  parametersChanged();
 }
 
 void MainWindow::on_spinBoxResolutionY_valueChanged(int arg1) {
   generator.setHeight(static_cast<unsigned int>(arg1));
+  parametersChanged();
 }
 
 void MainWindow::on_spinBoxMaxIterations_valueChanged(int arg1) {
   generator.setMaxIterations(static_cast<unsigned int>(arg1));
+  parametersChanged();
 }
 
 void MainWindow::on_OffsetX_valueChanged(double arg1) {
   generator.setOffsetX(arg1);
+  parametersChanged();
 }
 
 void MainWindow::on_OffsetY_valueChanged(double arg1) {
   generator.setOffsetY(arg1);
+  parametersChanged();
 }
 
 void MainWindow::on_doubleSpinBoxConstRealis_valueChanged(double arg1) {
   generator.setConstantRealis(arg1);
+  parametersChanged();
 }
 
 void MainWindow::on_doubleSpinBoxConstImaginalis_valueChanged(double arg1) {
   generator.setConstantImaginalis(arg1);
+  parametersChanged();
 }
 
 void MainWindow::on_pushButtonFitToView_clicked() {